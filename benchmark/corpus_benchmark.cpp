@@ -0,0 +1,119 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <docopt/docopt.h> // Library for parsing command line arguments
+#include <fmt/format.h> // Formatting library
+#include <spdlog/spdlog.h> // Logging library
+
+#include "corpus/reader.h"
+#include "simplify/simplify.h"
+
+constexpr std::string_view USAGE = R"(Replay the layers of a polygon corpus through Simplify, and measure the throughput.
+
+Usage:
+  corpus_benchmark [--stream] [--resolution=<micron>] [--repeat=<count>] <corpus>
+  corpus_benchmark (-h | --help)
+
+Options:
+  -h --help                 Show this screen.
+  <corpus>                  The corpus file to replay, as written by corpus_convert.
+  --stream                  Read the corpus one layer at a time instead of memory-mapping it.
+  --resolution=<micron>     The meshfix_maximum_resolution to simplify with [default: 500].
+  --repeat=<count>          The number of times to replay the corpus [default: 1].
+)";
+
+struct throughput
+{
+    size_t layers{ 0 };
+    size_t vertices{ 0 };
+    size_t simplified_vertices{ 0 };
+    std::chrono::steady_clock::duration decode{};
+    std::chrono::steady_clock::duration simplify{};
+};
+
+/*!
+ * Decode the paths of a layer and simplify them, like the plugin does for a
+ * simplify request.
+ */
+void replayLayer(const corpus::layer_view& layer, const int64_t max_resolution, std::vector<geometry::polygon_outer<>>& paths, throughput& stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+    paths.resize(layer.pathCount());
+    for (size_t path_idx = 0; path_idx < layer.pathCount(); ++path_idx)
+    {
+        const auto path = layer.path(path_idx);
+        paths[path_idx].clear();
+        paths[path_idx].reserve(path.size());
+        for (const auto& point : path)
+        {
+            paths[path_idx].push_back(point);
+        }
+        stats.vertices += path.size();
+    }
+    const auto decoded = std::chrono::steady_clock::now();
+
+    // Same argument order as the plugin, so that the results are comparable.
+    Simplify simpl(layer.maxDeviation(), max_resolution, layer.maxAreaDeviation());
+    for (const auto& path : paths)
+    {
+        stats.simplified_vertices += simpl.simplify(path).size();
+    }
+    stats.decode += decoded - start;
+    stats.simplify += std::chrono::steady_clock::now() - decoded;
+    ++stats.layers;
+}
+
+int main(int argc, const char** argv)
+{
+    const std::map<std::string, docopt::value> args = docopt::docopt(std::string{ USAGE }, { argv + 1, argv + argc });
+    const auto corpus_path = args.at("<corpus>").asString();
+    const auto max_resolution = static_cast<int64_t>(args.at("--resolution").asLong());
+    const auto repeat = args.at("--repeat").asLong();
+    const bool stream = args.at("--stream").asBool();
+
+    throughput stats;
+    std::vector<geometry::polygon_outer<>> paths; // Reused between layers, so that decoding doesn't allocate.
+    try
+    {
+        for (long run = 0; run < repeat; ++run)
+        {
+            if (stream)
+            {
+                corpus::corpus_stream corpus{ corpus_path };
+                while (corpus.next())
+                {
+                    replayLayer(corpus.layer(), max_resolution, paths, stats);
+                }
+            }
+            else
+            {
+                corpus::mapped_corpus corpus{ corpus_path };
+                corpus.adviseSequential();
+                for (size_t layer_idx = 0; layer_idx < corpus.layerCount(); ++layer_idx)
+                {
+                    replayLayer(corpus.layer(layer_idx), max_resolution, paths, stats);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::error("Could not read {}: {}", corpus_path, e.what());
+        return EXIT_FAILURE;
+    }
+
+    const auto seconds = [](const auto duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    };
+    spdlog::info("Replayed {} layers with {} vertices, simplified to {} vertices", stats.layers, stats.vertices, stats.simplified_vertices);
+    spdlog::info("Decode: {:.3f} s, {:.1f} M vertices/s", seconds(stats.decode), stats.vertices / seconds(stats.decode) / 1e6);
+    spdlog::info("Simplify: {:.3f} s, {:.1f} M vertices/s", seconds(stats.simplify), stats.vertices / seconds(stats.simplify) / 1e6);
+    return EXIT_SUCCESS;
+}
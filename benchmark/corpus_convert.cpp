@@ -0,0 +1,95 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <docopt/docopt.h> // Library for parsing command line arguments
+#include <fmt/format.h> // Formatting library
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <spdlog/spdlog.h> // Logging library
+
+#include "corpus/writer.h"
+#include "simplify/point_container.h"
+
+#include "cura/plugins/slots/simplify/v0/simplify.pb.h"
+
+constexpr std::string_view USAGE = R"(Convert simplify requests recorded by the plugin with --record into a polygon corpus.
+
+Usage:
+  corpus_convert <corpus> <recording>...
+  corpus_convert (-h | --help)
+
+Options:
+  -h --help                 Show this screen.
+  <corpus>                  The corpus file to write.
+  <recording>               A file of recorded simplify requests. Each request becomes a layer of the corpus.
+)";
+
+int main(int argc, const char** argv)
+{
+    const std::map<std::string, docopt::value> args = docopt::docopt(std::string{ USAGE }, { argv + 1, argv + argc });
+    const auto corpus_path = args.at("<corpus>").asString();
+
+    try
+    {
+        corpus::corpus_writer writer{ corpus_path };
+        size_t layer_count = 0;
+        size_t vertex_count = 0;
+        std::vector<std::vector<geometry::polygon_outer<>>> layer;
+        for (const auto& recording_path : args.at("<recording>").asStringList())
+        {
+            std::ifstream recording_file{ recording_path, std::ios::binary };
+            if (! recording_file)
+            {
+                spdlog::error("Could not open {}", recording_path);
+                return EXIT_FAILURE;
+            }
+            google::protobuf::io::IstreamInputStream recording{ &recording_file };
+            cura::plugins::slots::simplify::v0::CallRequest request;
+            bool clean_eof = false;
+            while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&request, &recording, &clean_eof))
+            {
+                layer.clear();
+                for (const auto& polygon : request.polygons().polygons())
+                {
+                    auto& paths = layer.emplace_back();
+                    auto& outline = paths.emplace_back();
+                    for (const auto& point : polygon.outline().path())
+                    {
+                        outline.emplace_back(point.x(), point.y());
+                    }
+                    vertex_count += outline.size();
+                    for (const auto& hole : polygon.holes())
+                    {
+                        auto& hole_path = paths.emplace_back();
+                        for (const auto& point : hole.path())
+                        {
+                            hole_path.emplace_back(point.x(), point.y());
+                        }
+                        vertex_count += hole_path.size();
+                    }
+                }
+                writer.writeLayer(request.max_deviation(), request.max_area_deviation(), layer);
+                ++layer_count;
+                request.Clear(); // Parsing merges into the message.
+            }
+            if (! clean_eof)
+            {
+                spdlog::warn("{} ends with a truncated request, which was skipped", recording_path);
+            }
+        }
+        writer.close();
+        spdlog::info("Wrote {} layers with {} vertices to {}", layer_count, vertex_count, corpus_path);
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::error("Could not write the corpus: {}", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <docopt/docopt.h> // Library for parsing command line arguments
+#include <fmt/format.h> // Formatting library
+#include <grpcpp/client_context.h>
+#include <grpcpp/create_channel.h>
+#include <spdlog/spdlog.h> // Logging library
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cura/plugins/slots/handshake/v0/handshake.grpc.pb.h"
+#include "cura/plugins/slots/handshake/v0/handshake.pb.h"
+
+extern char** environ;
+
+constexpr std::string_view USAGE = R"(Measure the time from launching the plugin to its readiness and first handshake.
+
+Usage:
+  startup_benchmark [--plugin=<path>] [--runs=<count>] [--port=<port>]
+  startup_benchmark (-h | --help)
+
+Options:
+  -h --help                 Show this screen.
+  --plugin=<path>           The plugin executable to launch [default: {0}].
+  --runs=<count>            The number of cold starts to measure [default: 20].
+  --port=<port>             The port to let the plugin listen on [default: 33799].
+)";
+
+struct startup_sample
+{
+    double ready_ms;
+    double handshake_ms;
+};
+
+/*!
+ * Launch the plugin once, and measure how long it takes until it reports to be
+ * ready and until it answers the first handshake.
+ */
+std::optional<startup_sample> measure(const std::string& plugin, const std::string& port)
+{
+    int ready_pipe[2];
+    if (::pipe(ready_pipe) != 0)
+    {
+        return std::nullopt;
+    }
+
+    const auto ready_fd = fmt::format("--ready-fd={}", ready_pipe[1]);
+    const auto port_arg = fmt::format("--port={}", port);
+    std::vector<char*> argv{ const_cast<char*>(plugin.c_str()), const_cast<char*>(port_arg.c_str()), const_cast<char*>(ready_fd.c_str()), nullptr };
+
+    posix_spawn_file_actions_t file_actions;
+    posix_spawn_file_actions_init(&file_actions);
+    posix_spawn_file_actions_addclose(&file_actions, ready_pipe[0]);
+    posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    pid_t pid;
+    const int spawned = posix_spawn(&pid, plugin.c_str(), &file_actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&file_actions);
+    ::close(ready_pipe[1]);
+    if (spawned != 0)
+    {
+        ::close(ready_pipe[0]);
+        spdlog::error("Could not launch {}: {}", plugin, std::strerror(spawned));
+        return std::nullopt;
+    }
+
+    // Blocks until the plugin writes its readiness line, or closes the pipe when it exits.
+    char buffer[256];
+    const bool ready = ::read(ready_pipe[0], buffer, sizeof(buffer)) > 0;
+    ::close(ready_pipe[0]);
+    const auto ready_time = std::chrono::steady_clock::now();
+
+    // Poll the handshake like the engine does.
+    auto stub = cura::plugins::slots::handshake::v0::HandshakeService::NewStub(grpc::CreateChannel(fmt::format("localhost:{}", port), grpc::InsecureChannelCredentials()));
+    bool shook_hands = false;
+    while (ready && ! shook_hands && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        grpc::ClientContext client_context;
+        client_context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(100));
+        cura::plugins::slots::handshake::v0::CallRequest request;
+        cura::plugins::slots::handshake::v0::CallResponse response;
+        shook_hands = stub->Call(&client_context, request, &response).ok();
+    }
+    const auto handshake_time = std::chrono::steady_clock::now();
+
+    ::kill(pid, SIGTERM);
+    ::waitpid(pid, nullptr, 0);
+    if (! ready || ! shook_hands)
+    {
+        spdlog::error("The plugin did not become ready");
+        return std::nullopt;
+    }
+    return startup_sample{ .ready_ms = std::chrono::duration<double, std::milli>(ready_time - start).count(),
+                           .handshake_ms = std::chrono::duration<double, std::milli>(handshake_time - start).count() };
+}
+
+int main(int argc, const char** argv)
+{
+    const std::map<std::string, docopt::value> args = docopt::docopt(fmt::format(USAGE, PLUGIN_EXECUTABLE), { argv + 1, argv + argc });
+    const auto plugin = args.at("--plugin").asString();
+    const auto port = args.at("--port").asString();
+    const auto runs = args.at("--runs").asLong();
+    if (runs < 1)
+    {
+        spdlog::error("At least one run is needed");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<startup_sample> samples;
+    for (long run = 0; run < runs; ++run)
+    {
+        if (const auto sample = measure(plugin, port))
+        {
+            samples.push_back(sample.value());
+        }
+        else
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto report = [&samples](const std::string_view name, auto member)
+    {
+        std::vector<double> times;
+        std::ranges::transform(samples, std::back_inserter(times), member);
+        std::ranges::sort(times);
+        spdlog::info("{}: min {:.3f} ms, median {:.3f} ms, max {:.3f} ms", name, times.front(), times[times.size() / 2], times.back());
+    };
+    report("Launch to ready", &startup_sample::ready_ms);
+    report("Launch to first handshake", &startup_sample::handshake_ms);
+    return EXIT_SUCCESS;
+}
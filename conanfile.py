@@ -25,10 +25,12 @@ class CuraEngineSimplifyPluginConan(ConanFile):
     options = {
         "shared": [True, False],
         "fPIC": [True, False],
+        "enable_tracing": [True, False],
     }
     default_options = {
         "shared": False,
         "fPIC": True,
+        "enable_tracing": False,
     }
 
     @property
@@ -50,6 +52,8 @@ class CuraEngineSimplifyPluginConan(ConanFile):
         copy(self, "*", os.path.join(self.recipe_folder, "src"), os.path.join(self.export_sources_folder, "src"))
         copy(self, "*", os.path.join(self.recipe_folder, "include"), os.path.join(self.export_sources_folder, "include"))
         copy(self, "*", os.path.join(self.recipe_folder, "tests"), os.path.join(self.export_sources_folder, "tests"))
+        copy(self, "*", os.path.join(self.recipe_folder, "fuzz"), os.path.join(self.export_sources_folder, "fuzz"))
+        copy(self, "*", os.path.join(self.recipe_folder, "benchmark"), os.path.join(self.export_sources_folder, "benchmark"))
 
     def config_options(self):
         if self.settings.os == "Windows":
@@ -106,6 +110,7 @@ class CuraEngineSimplifyPluginConan(ConanFile):
         if is_msvc(self):
             tc.variables["USE_MSVC_RUNTIME_LIBRARY_DLL"] = not is_msvc_static_runtime(self)
         tc.cache_variables["CMAKE_POLICY_DEFAULT_CMP0077"] = "NEW"
+        tc.variables["ENABLE_TRACING"] = self.options.enable_tracing
         cpp_info = self.dependencies["curaengine_grpc_definitions"].cpp_info
         tc.variables["GRPC_IMPORT_DIRS"] = cpp_info.resdirs[0].replace("\\", "/")
         tc.variables["GRPC_PROTOS"] = ";".join([str(p).replace("\\", "/") for p in Path(cpp_info.resdirs[0]).rglob("*.proto")])
@@ -0,0 +1,129 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef FUZZ_POLYGON_GENERATOR_H
+#define FUZZ_POLYGON_GENERATOR_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+
+#include "simplify/point_container.h"
+
+namespace fuzz
+{
+
+/*!
+ * The kinds of polygonal chains that are generated. Besides plain random
+ * input, these cover the inputs on which the simplification kernels are most
+ * likely to disagree or to overflow.
+ */
+enum class shape
+{
+    RANDOM, //!< Vertices scattered uniformly in a small square.
+    CIRCLE, //!< A noisy circle, the typical output of a curved wall.
+    COLLINEAR, //!< Long runs of collinear vertices, with the occasional jog.
+    DUPLICATES, //!< Vertices that are repeated, producing zero-length edges.
+    HUGE_COORDINATES, //!< Vertices close to the limits of int32_t.
+    SPIKES, //!< A circle with narrow spikes, producing near-parallel edges.
+};
+
+/*!
+ * Settings to construct a simplifier with.
+ */
+struct settings
+{
+    int64_t max_resolution;
+    int64_t max_deviation;
+    int64_t max_area_deviation;
+};
+
+/*!
+ * Pick simplification settings in the range that CuraEngine actually uses, plus
+ * the degenerate zero values.
+ * \param pick Callable that returns an integer in the closed range [lo, hi].
+ */
+settings pickSettings(auto&& pick)
+{
+    return settings{ .max_resolution = pick(0, 2000), .max_deviation = pick(0, 200), .max_area_deviation = pick(0, 100000) };
+}
+
+/*!
+ * Generate a polygonal chain.
+ * \tparam Polygonal The type of polygonal chain to generate.
+ * \param pick Callable that returns an integer in the closed range [lo, hi].
+ * Driving the generator through this callable lets both a seeded random engine
+ * and the fuzzer's data provider produce the same kinds of shapes.
+ * \param max_size The maximum number of vertices to generate.
+ * \return The generated polygonal chain.
+ */
+template<concepts::poly_range Polygonal>
+Polygonal generate(auto&& pick, const int64_t max_size)
+{
+    constexpr int64_t int32_max = std::numeric_limits<int32_t>::max();
+    Polygonal polygon;
+    const auto kind = static_cast<shape>(pick(0, static_cast<int64_t>(shape::SPIKES)));
+    const auto size = pick(0, max_size);
+
+    switch (kind)
+    {
+    case shape::RANDOM:
+        for (int64_t i = 0; i < size; ++i)
+        {
+            polygon.emplace_back(pick(-10000, 10000), pick(-10000, 10000));
+        }
+        break;
+    case shape::CIRCLE:
+    case shape::SPIKES:
+    {
+        const auto radius = static_cast<double>(pick(10, 100000));
+        const auto noise = pick(0, 20);
+        for (int64_t i = 0; i < size; ++i)
+        {
+            const double angle = 2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(size);
+            const double spike = kind == shape::SPIKES && i % 7 == 3 ? static_cast<double>(pick(1, 10)) : 1.0;
+            polygon.emplace_back(static_cast<int64_t>(radius * spike * std::cos(angle)) + pick(-noise, noise), static_cast<int64_t>(radius * spike * std::sin(angle)) + pick(-noise, noise));
+        }
+        break;
+    }
+    case shape::COLLINEAR:
+    {
+        geometry::Point position{ pick(-10000, 10000), pick(-10000, 10000) };
+        geometry::Point step{ pick(-100, 100), pick(-100, 100) };
+        for (int64_t i = 0; i < size; ++i)
+        {
+            polygon.emplace_back(position);
+            if (pick(0, 15) == 0)
+            {
+                step = geometry::Point{ pick(-100, 100), pick(-100, 100) };
+            }
+            position = position + step;
+        }
+        break;
+    }
+    case shape::DUPLICATES:
+        while (static_cast<int64_t>(polygon.size()) < size)
+        {
+            const geometry::Point vertex{ pick(-1000, 1000), pick(-1000, 1000) };
+            for (auto repeat = pick(1, 4); repeat > 0; --repeat)
+            {
+                polygon.emplace_back(vertex);
+            }
+        }
+        break;
+    case shape::HUGE_COORDINATES:
+        for (int64_t i = 0; i < size; ++i)
+        {
+            const auto sign_x = pick(0, 1) == 0 ? -1 : 1;
+            const auto sign_y = pick(0, 1) == 0 ? -1 : 1;
+            polygon.emplace_back(sign_x * pick(int32_max - 10000, int32_max), sign_y * pick(int32_max - 10000, int32_max));
+        }
+        break;
+    }
+    return polygon;
+}
+
+} // namespace fuzz
+
+#endif // FUZZ_POLYGON_GENERATOR_H
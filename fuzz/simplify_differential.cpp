@@ -0,0 +1,132 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <docopt/docopt.h> // Library for parsing command line arguments
+#include <fmt/format.h> // Formatting library
+#include <spdlog/spdlog.h> // Logging library
+
+#include "polygon_generator.h"
+#include "variants.h"
+
+constexpr std::string_view USAGE = R"(Differential test of the Simplify engine variants against the reference.
+
+Usage:
+  simplify_differential [--iterations=<count>] [--seed=<seed>] [--max-size=<count>]
+  simplify_differential (-h | --help)
+
+Options:
+  -h --help                 Show this screen.
+  --iterations=<count>      The number of polygons and polylines to generate [default: 10000].
+  --seed=<seed>             The seed of the random generator [default: 0].
+  --max-size=<count>        The maximum number of vertices per generated chain [default: 2048].
+)";
+
+struct throughput
+{
+    size_t vertices{ 0 };
+    std::chrono::steady_clock::duration duration{};
+};
+
+template<concepts::poly_range Polygonal>
+auto timed(const fuzz::variant& engine, const fuzz::settings& settings, const Polygonal& input, throughput& stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+    auto output = fuzz::simplifyFunction<Polygonal>(engine)(settings, input);
+    stats.duration += std::chrono::steady_clock::now() - start;
+    stats.vertices += input.size();
+    return output;
+}
+
+template<concepts::poly_range Polygonal>
+size_t compareVariants(const fuzz::settings& settings, const Polygonal& input, std::map<std::string_view, throughput>& stats, const uint64_t seed)
+{
+    size_t failures = 0;
+    const Polygonal expected = timed(fuzz::reference_variant, settings, input, stats[fuzz::reference_variant.name]);
+    for (const auto& engine : fuzz::variants)
+    {
+        const Polygonal output = timed(engine, settings, input, stats[engine.name]);
+        if (const auto failure = fuzz::check(input, expected, output))
+        {
+            spdlog::error("Variant {} failed on {} vertices (seed {}): {}", engine.name, input.size(), seed, failure.value());
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+template<concepts::poly_range Polygonal>
+size_t compareBudget(const fuzz::settings& settings, const Polygonal& input, auto&& pick, const uint64_t seed)
+{
+    const auto vertex_budget = static_cast<size_t>(pick(1, std::max<int64_t>(static_cast<int64_t>(input.size()), 1)));
+    const auto deviation_ceiling = pick(0, 400);
+    if (const auto failure = fuzz::checkBudget(settings, input, vertex_budget, deviation_ceiling))
+    {
+        spdlog::error("Budget of {} vertices failed on {} vertices (seed {}): {}", vertex_budget, input.size(), seed, failure.value());
+        return 1;
+    }
+    return 0;
+}
+
+template<concepts::poly_range Polygonal>
+size_t compareIncremental(const fuzz::settings& settings, const Polygonal& input, auto&& pick, const uint64_t seed)
+{
+    if (const auto failure = fuzz::checkIncremental(settings, input, pick))
+    {
+        spdlog::error("Incremental simplification failed on {} vertices (seed {}): {}", input.size(), seed, failure.value());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, const char** argv)
+{
+    const std::map<std::string, docopt::value> args = docopt::docopt(std::string{ USAGE }, { argv + 1, argv + argc });
+    const auto iterations = args.at("--iterations").asLong();
+    const auto seed = static_cast<uint64_t>(args.at("--seed").asLong());
+    const auto max_size = args.at("--max-size").asLong();
+
+    std::map<std::string_view, throughput> stats;
+    size_t failures = 0;
+    for (long iteration = 0; iteration < iterations; ++iteration)
+    {
+        // Seed every iteration separately, so that a failure can be reproduced on its own.
+        const uint64_t iteration_seed = seed + static_cast<uint64_t>(iteration);
+        std::mt19937_64 engine{ iteration_seed };
+        auto pick = [&engine](const int64_t lo, const int64_t hi) { return std::uniform_int_distribution<int64_t>{ lo, hi }(engine); };
+
+        const auto settings = fuzz::pickSettings(pick);
+        if (iteration % 2 == 0)
+        {
+            const auto input = fuzz::generate<fuzz::closed_t>(pick, max_size);
+            failures += compareVariants(settings, input, stats, iteration_seed);
+            failures += compareBudget(settings, input, pick, iteration_seed);
+            failures += compareIncremental(settings, input, pick, iteration_seed);
+        }
+        else
+        {
+            const auto input = fuzz::generate<fuzz::open_t>(pick, max_size);
+            failures += compareVariants(settings, input, stats, iteration_seed);
+            failures += compareBudget(settings, input, pick, iteration_seed);
+            failures += compareIncremental(settings, input, pick, iteration_seed);
+        }
+    }
+
+    for (const auto& [name, result] : stats)
+    {
+        const auto seconds = std::chrono::duration<double>(result.duration).count();
+        spdlog::info("{}: {} vertices in {:.3f} s ({:.2f} Mvertices/s)", name, result.vertices, seconds, seconds > 0.0 ? static_cast<double>(result.vertices) / seconds / 1e6 : 0.0);
+    }
+    if (failures > 0)
+    {
+        spdlog::error("{} of {} chains failed", failures, iterations);
+        return EXIT_FAILURE;
+    }
+    spdlog::info("All {} chains passed", iterations);
+    return EXIT_SUCCESS;
+}
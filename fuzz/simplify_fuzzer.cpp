@@ -0,0 +1,71 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <fuzzer/FuzzedDataProvider.h>
+#include <spdlog/spdlog.h> // Logging library
+
+#include "polygon_generator.h"
+#include "variants.h"
+
+template<concepts::poly_range Polygonal>
+void fuzzVariants(const fuzz::settings& settings, const Polygonal& input)
+{
+    const Polygonal expected = fuzz::simplifyFunction<Polygonal>(fuzz::reference_variant)(settings, input);
+    for (const auto& engine : fuzz::variants)
+    {
+        const Polygonal output = fuzz::simplifyFunction<Polygonal>(engine)(settings, input);
+        if (const auto failure = fuzz::check(input, expected, output))
+        {
+            spdlog::critical("Variant {} failed on {} vertices: {}", engine.name, input.size(), failure.value());
+            std::abort();
+        }
+    }
+}
+
+template<concepts::poly_range Polygonal>
+void fuzzBudget(const fuzz::settings& settings, const Polygonal& input, const size_t vertex_budget, const int64_t deviation_ceiling)
+{
+    if (const auto failure = fuzz::checkBudget(settings, input, vertex_budget, deviation_ceiling))
+    {
+        spdlog::critical("Budget of {} vertices failed on {} vertices: {}", vertex_budget, input.size(), failure.value());
+        std::abort();
+    }
+}
+
+template<concepts::poly_range Polygonal>
+void fuzzIncremental(const fuzz::settings& settings, const Polygonal& input, auto&& pick)
+{
+    if (const auto failure = fuzz::checkIncremental(settings, input, pick))
+    {
+        spdlog::critical("Incremental simplification failed on {} vertices: {}", input.size(), failure.value());
+        std::abort();
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    FuzzedDataProvider provider(data, size);
+    auto pick = [&provider](const int64_t lo, const int64_t hi) { return provider.ConsumeIntegralInRange<int64_t>(lo, hi); };
+
+    const auto settings = fuzz::pickSettings(pick);
+    const auto vertex_budget = static_cast<size_t>(pick(0, 4096));
+    const auto deviation_ceiling = pick(0, 400);
+    if (provider.ConsumeBool())
+    {
+        const auto input = fuzz::generate<fuzz::closed_t>(pick, 4096);
+        fuzzVariants(settings, input);
+        fuzzBudget(settings, input, vertex_budget, deviation_ceiling);
+        fuzzIncremental(settings, input, pick);
+    }
+    else
+    {
+        const auto input = fuzz::generate<fuzz::open_t>(pick, 4096);
+        fuzzVariants(settings, input);
+        fuzzBudget(settings, input, vertex_budget, deviation_ceiling);
+        fuzzIncremental(settings, input, pick);
+    }
+    return 0;
+}
@@ -0,0 +1,413 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef FUZZ_VARIANTS_H
+#define FUZZ_VARIANTS_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "polygon_generator.h"
+#include "reference_simplify.h"
+#include "simplify/incremental.h"
+#include "simplify/simplify.h"
+
+namespace fuzz
+{
+
+using closed_t = geometry::polygon_outer<>;
+using open_t = geometry::polyline<>;
+
+/*!
+ * A simplification engine that is checked against the reference.
+ *
+ * Add new kernels (integer, SIMD, other heaps or layouts) to the list of
+ * variants below to have them fuzzed and benchmarked against the reference.
+ * Variants must produce exactly the same vertices as the reference. The greedy
+ * reference is too unstable to bound how much further a different algorithm
+ * may deviate, so algorithms that are meant to differ get their own check with
+ * a bound that follows from how they work, like checkBudget() and
+ * checkIncremental().
+ */
+struct variant
+{
+    std::string_view name;
+    std::function<closed_t(const settings&, const closed_t&)> simplify_closed;
+    std::function<open_t(const settings&, const open_t&)> simplify_open;
+};
+
+/*!
+ * The reference, which is the frozen copy of the original simplification.
+ */
+inline const variant reference_variant{
+    .name = "reference",
+    .simplify_closed = [](const settings& s, const closed_t& polygon) { return reference::Simplify{ s.max_resolution, s.max_deviation, s.max_area_deviation }.simplify(polygon); },
+    .simplify_open = [](const settings& s, const open_t& polygon) { return reference::Simplify{ s.max_resolution, s.max_deviation, s.max_area_deviation }.simplify(polygon); },
+};
+
+/*!
+ * Edit a polygonal chain, the way the next layer of a model may differ from the
+ * previous one: a few runs of vertices are moved, removed or replaced by new
+ * vertices.
+ * \param pick Callable that returns an integer in the closed range [lo, hi].
+ * \param polygon The chain to edit.
+ * \return The edited chain.
+ */
+template<concepts::poly_range Polygonal>
+Polygonal editChain(auto&& pick, const Polygonal& polygon)
+{
+    auto clamped = [](const int64_t x, const int64_t y)
+    {
+        constexpr int64_t int32_max = std::numeric_limits<int32_t>::max();
+        return geometry::Point(std::clamp(x, -int32_max, int32_max), std::clamp(y, -int32_max, int32_max));
+    };
+
+    Polygonal edited{ polygon };
+    const auto edit_count = pick(1, 3);
+    for (int64_t edit = 0; edit < edit_count && ! edited.empty(); ++edit)
+    {
+        const auto size = static_cast<int64_t>(edited.size());
+        const auto begin = pick(0, size - 1);
+        const auto end = std::min(size, begin + pick(1, std::max<int64_t>(size / 8, 1)));
+        switch (pick(0, 3))
+        {
+        case 0: // Shift a run of vertices, like a wall that moved.
+        {
+            const auto dx = pick(-1000, 1000);
+            const auto dy = pick(-1000, 1000);
+            for (auto i = begin; i < end; ++i)
+            {
+                edited[i] = clamped(edited[i].X + dx, edited[i].Y + dy);
+            }
+            break;
+        }
+        case 1: // Move every vertex of a run separately, like a changed curve.
+            for (auto i = begin; i < end; ++i)
+            {
+                edited[i] = clamped(edited[i].X + pick(-200, 200), edited[i].Y + pick(-200, 200));
+            }
+            break;
+        case 2: // Remove a run of vertices.
+            edited.erase(edited.begin() + begin, edited.begin() + end);
+            break;
+        default: // Insert new vertices between two existing ones.
+        {
+            const auto& from = edited[begin];
+            const auto& to = edited[(begin + 1) % size];
+            Polygonal inserted;
+            const auto count = end - begin;
+            for (int64_t i = 1; i <= count; ++i)
+            {
+                inserted.push_back(clamped(from.X + (to.X - from.X) * i / (count + 1) + pick(-200, 200), from.Y + (to.Y - from.Y) * i / (count + 1) + pick(-200, 200)));
+            }
+            edited.insert(edited.begin() + begin + 1, inserted.begin(), inserted.end());
+            break;
+        }
+        }
+    }
+    return edited;
+}
+
+/*!
+ * The engine variants that are checked against the reference.
+ */
+inline const std::array variants{
+    variant{
+        .name = "simplify",
+        .simplify_closed = [](const settings& s, const closed_t& polygon) { return Simplify{ s.max_resolution, s.max_deviation, s.max_area_deviation }.simplify(polygon); },
+        .simplify_open = [](const settings& s, const open_t& polygon) { return Simplify{ s.max_resolution, s.max_deviation, s.max_area_deviation }.simplify(polygon); },
+    },
+    variant{
+        .name = "simplify_to_budget",
+        // Without a budget it must behave exactly like the regular simplification.
+        .simplify_closed = [](const settings& s, const closed_t& polygon) { return Simplify{ s.max_resolution, s.max_deviation, s.max_area_deviation }.simplifyToBudget(std::vector<closed_t>{ polygon }, 0, 0).front(); },
+        .simplify_open = [](const settings& s, const open_t& polygon) { return Simplify{ s.max_resolution, s.max_deviation, s.max_area_deviation }.simplifyToBudget(std::vector<open_t>{ polygon }, 0, 0).front(); },
+    },
+};
+
+/*!
+ * Get the simplification function of a variant for a type of polygonal chain.
+ */
+template<concepts::poly_range Polygonal>
+const auto& simplifyFunction(const variant& engine)
+{
+    if constexpr (concepts::is_closed_point_container<Polygonal>)
+    {
+        return engine.simplify_closed;
+    }
+    else
+    {
+        return engine.simplify_open;
+    }
+}
+
+/*!
+ * The squared distance from a point to a line segment.
+ */
+inline double squaredSegmentDistance(const geometry::Point& p, const geometry::Point& a, const geometry::Point& b)
+{
+    const double ab_x = static_cast<double>(b.X) - static_cast<double>(a.X);
+    const double ab_y = static_cast<double>(b.Y) - static_cast<double>(a.Y);
+    const double ap_x = static_cast<double>(p.X) - static_cast<double>(a.X);
+    const double ap_y = static_cast<double>(p.Y) - static_cast<double>(a.Y);
+    const double length2 = ab_x * ab_x + ab_y * ab_y;
+    const double t = length2 == 0.0 ? 0.0 : std::clamp((ap_x * ab_x + ap_y * ab_y) / length2, 0.0, 1.0);
+    const double dx = ap_x - t * ab_x;
+    const double dy = ap_y - t * ab_y;
+    return dx * dx + dy * dy;
+}
+
+/*!
+ * The largest distance from an input vertex that was removed between two
+ * remaining vertices to the segment between them.
+ * \param input The chain before simplification.
+ * \param marked The chain after simplification, before the deleted vertices
+ * were removed, so with the same vertex indices as the input.
+ * \param from The remaining vertex at the start of the segment.
+ * \param to The remaining vertex at the end of the segment.
+ */
+template<concepts::poly_range Polygonal>
+double spanDeviation(const Polygonal& input, const Polygonal& marked, const size_t from, const size_t to)
+{
+    double largest = 0.0; // Squared, to only take a square root at the end.
+    for (size_t i = (from + 1) % input.size(); i != to; i = (i + 1) % input.size())
+    {
+        largest = std::max(largest, squaredSegmentDistance(input[i], marked[from], marked[to]));
+    }
+    return std::sqrt(largest);
+}
+
+/*!
+ * The indices of the vertices that are not deleted.
+ */
+inline std::vector<size_t> remainingVertices(const std::vector<bool>& to_delete)
+{
+    std::vector<size_t> remaining;
+    for (size_t i = 0; i < to_delete.size(); ++i)
+    {
+        if (! to_delete[i])
+        {
+            remaining.push_back(i);
+        }
+    }
+    return remaining;
+}
+
+/*!
+ * The largest distance from any input vertex to the segment of the simplified
+ * chain that replaced it.
+ *
+ * This is at least as large as the distance to the closest segment of the
+ * simplified chain, and it can be bounded per segment.
+ * \param input The chain before simplification.
+ * \param marked The chain after simplification, before the deleted vertices
+ * were removed, so with the same vertex indices as the input.
+ * \param to_delete For each vertex, whether it was deleted.
+ */
+template<concepts::poly_range Polygonal>
+double coverageDeviation(const Polygonal& input, const Polygonal& marked, const std::vector<bool>& to_delete)
+{
+    const auto remaining = remainingVertices(to_delete);
+    double largest = 0.0;
+    for (size_t i = 0; i + 1 < remaining.size(); ++i)
+    {
+        largest = std::max(largest, spanDeviation(input, marked, remaining[i], remaining[i + 1]));
+    }
+    if (concepts::is_closed_point_container<Polygonal> && remaining.size() > 1)
+    {
+        largest = std::max(largest, spanDeviation(input, marked, remaining.back(), remaining.front()));
+    }
+    return largest;
+}
+
+/*!
+ * Check the output of any simplification against the invariants that all of
+ * them must satisfy.
+ * \param input The chain that was simplified.
+ * \param output The simplified chain.
+ * \return A description of the first violated invariant, if any.
+ */
+template<concepts::poly_range Polygonal>
+std::optional<std::string> checkInvariants(const Polygonal& input, const Polygonal& output)
+{
+    constexpr bool is_closed = concepts::is_closed_point_container<Polygonal>;
+    constexpr size_t min_size = is_closed ? 3 : 2;
+
+    if (input.size() < min_size && ! output.empty())
+    {
+        return fmt::format("degenerate input of {} vertices should be removed, got {} vertices", input.size(), output.size());
+    }
+    if (input.size() >= min_size && (output.size() < min_size || output.size() > input.size()))
+    {
+        return fmt::format("expected between {} and {} vertices, got {}", min_size, input.size(), output.size());
+    }
+    if (! is_closed && ! output.empty() && (output.front() != input.front() || output.back() != input.back()))
+    {
+        return std::string{ "endpoints of the polyline were not retained" };
+    }
+    return std::nullopt;
+}
+
+/*!
+ * Check the output of a variant against the invariants of simplification and
+ * against the output of the reference.
+ * \param input The chain that was simplified.
+ * \param expected The output of the reference for the same input.
+ * \param output The output of the variant.
+ * \return A description of the first violated invariant, if any.
+ */
+template<concepts::poly_range Polygonal>
+std::optional<std::string> check(const Polygonal& input, const Polygonal& expected, const Polygonal& output)
+{
+    if (const auto failure = checkInvariants(input, output))
+    {
+        return failure;
+    }
+    if (! std::equal(output.begin(), output.end(), expected.begin(), expected.end()))
+    {
+        return fmt::format("output differs from the reference ({} vs {} vertices)", output.size(), expected.size());
+    }
+    return std::nullopt;
+}
+
+/*!
+ * Check simplification to a vertex budget of a layer that consists of a single
+ * chain.
+ *
+ * The deviation is measured with coverageDeviation().
+ * \param s The simplification settings.
+ * \param input The chain to simplify.
+ * \param vertex_budget The maximum number of vertices to keep.
+ * \param deviation_ceiling The largest deviation allowed to meet the budget.
+ * \return A description of the first violated invariant, if any.
+ */
+template<concepts::poly_range Polygonal>
+std::optional<std::string> checkBudget(const settings& s, const Polygonal& input, const size_t vertex_budget, const int64_t deviation_ceiling)
+{
+    constexpr bool is_closed = concepts::is_closed_point_container<Polygonal>;
+    constexpr size_t min_size = is_closed ? 3 : 2;
+    constexpr double rounding = 1e-6;
+    if (input.size() < min_size)
+    {
+        return std::nullopt; // Degenerate input is covered by checkInvariants().
+    }
+
+    Simplify simplifier{ s.max_resolution, s.max_deviation, s.max_area_deviation };
+    const auto [marked, to_delete] = simplifier.markToBudget(std::vector<Polygonal>{ input }, vertex_budget, deviation_ceiling);
+    const auto [unbudgeted, unbudgeted_to_delete] = simplifier.mark(input);
+    const auto& chain = marked.front();
+
+    const auto remaining = remainingVertices(to_delete.front());
+    const auto unbudgeted_remaining = remainingVertices(unbudgeted_to_delete);
+
+    if (unbudgeted_remaining.size() < remaining.size() || remaining.size() < min_size)
+    {
+        return fmt::format("budget of {} kept {} vertices, but regular simplification kept {}", vertex_budget, remaining.size(), unbudgeted_remaining.size());
+    }
+    if (! is_closed && (remaining.front() != 0 || remaining.back() != input.size() - 1))
+    {
+        return std::string{ "endpoints of the polyline were not retained to meet the budget" };
+    }
+
+    // Only the deviation of the regular simplification may exceed the ceiling.
+    const double budget_deviation = coverageDeviation(input, chain, to_delete.front());
+    const double unbudgeted_deviation = coverageDeviation(input, unbudgeted, unbudgeted_to_delete);
+    if (budget_deviation > std::max(static_cast<double>(deviation_ceiling), unbudgeted_deviation) + rounding)
+    {
+        return fmt::format("deviation of {} exceeds the ceiling of {} (regular simplification deviates {})", budget_deviation, deviation_ceiling, unbudgeted_deviation);
+    }
+
+    // If the budget is not met, no vertex may be left that could be removed within the ceiling.
+    if (vertex_budget == 0 || remaining.size() <= vertex_budget || remaining.size() <= min_size)
+    {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < remaining.size(); ++i)
+    {
+        if (! is_closed && (i == 0 || i == remaining.size() - 1))
+        {
+            continue;
+        }
+        const size_t before = remaining[(i + remaining.size() - 1) % remaining.size()];
+        const size_t after = remaining[(i + 1) % remaining.size()];
+        if (spanDeviation(input, chain, before, after) < static_cast<double>(deviation_ceiling) - rounding)
+        {
+            return fmt::format("kept {} vertices for a budget of {}, but vertex {} can be removed within the ceiling of {}", remaining.size(), vertex_budget, remaining[i], deviation_ceiling);
+        }
+    }
+    return std::nullopt;
+}
+
+/*!
+ * Check incremental simplification of a chain, after simplifying an edited
+ * version of it as the previous layer.
+ *
+ * Outside of the range that was simplified again, the result is re-used from
+ * the previous layer, where the input is the same. Inside of it, the result is
+ * the simplification of that range on its own. So the deviation may not exceed
+ * the larger of the deviations of simplifying the previous chain and the range
+ * from scratch. If the chain was simplified from scratch, it must be exactly
+ * the regular simplification.
+ * \param s The simplification settings.
+ * \param input The chain to simplify.
+ * \param pick Callable that returns an integer in the closed range [lo, hi],
+ * used to edit the previous layer.
+ * \return A description of the first violated invariant, if any.
+ */
+template<concepts::poly_range Polygonal>
+std::optional<std::string> checkIncremental(const settings& s, const Polygonal& input, auto&& pick)
+{
+    constexpr double rounding = 1e-6;
+
+    Simplify simplifier{ s.max_resolution, s.max_deviation, s.max_area_deviation };
+    const Polygonal previous = editChain(pick, input);
+    incremental_state<Polygonal> state;
+    simplifyIncremental(simplifier, previous, state);
+    const Polygonal output = simplifyIncremental(simplifier, input, state);
+    if (const auto failure = checkInvariants(input, output))
+    {
+        return failure;
+    }
+
+    if (state.window_end == 0)
+    {
+        const Polygonal expected = simplifier.simplify(input);
+        if (! std::equal(output.begin(), output.end(), expected.begin(), expected.end()))
+        {
+            return fmt::format("simplified from scratch, but differs from the regular simplification ({} vs {} vertices)", output.size(), expected.size());
+        }
+        return std::nullopt;
+    }
+
+    const auto [previous_marked, previous_to_delete] = simplifier.mark(previous);
+    geometry::polyline<typename Polygonal::value_type> window;
+    window.emplace_back(state.marked[state.window_begin]);
+    for (size_t i = state.window_begin + 1; i < state.window_end; ++i)
+    {
+        window.emplace_back(input[i]);
+    }
+    window.emplace_back(state.marked[state.window_end]);
+    const auto [window_marked, window_to_delete] = simplifier.mark(window);
+
+    const double previous_deviation = coverageDeviation(previous, previous_marked, previous_to_delete);
+    const double window_deviation = coverageDeviation(window, window_marked, window_to_delete);
+    const double output_deviation = coverageDeviation(input, state.marked, state.to_delete);
+    if (output_deviation > std::max(previous_deviation, window_deviation) + rounding)
+    {
+        return fmt::format("deviation of {} exceeds both the previous layer ({}) and the re-simplified range {}-{} ({})", output_deviation, previous_deviation, state.window_begin, state.window_end, window_deviation);
+    }
+    return std::nullopt;
+}
+
+} // namespace fuzz
+
+#endif // FUZZ_VARIANTS_H
@@ -0,0 +1,125 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef CORPUS_FORMAT_H
+#define CORPUS_FORMAT_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/*!
+ * On-disk format of polygon corpora, used to benchmark and replay real layer
+ * geometry at scale.
+ *
+ * A corpus file is laid out as follows, all integers little-endian:
+ *
+ * - file_header
+ * - One chunk per layer, each starting at an 8-byte aligned offset:
+ *   - layer_header
+ *   - uint32_t polygon_paths[polygon_count + 1]: the index of the first path
+ *     of each polygon. The first path of a polygon is its outline, the others
+ *     are its holes.
+ *   - uint32_t path_vertices[path_count]: the number of vertices of each path.
+ *   - uint32_t x_offsets[path_count + 1], uint32_t y_offsets[path_count + 1]:
+ *     the byte offset of each path in the X and Y columns.
+ *   - The X column, then the Y column. Each path stores the differences
+ *     between consecutive coordinates, starting from 0, as zigzag varints.
+ * - uint64_t layer_offsets[layer_count]: the file offset of each chunk.
+ * - file_footer
+ *
+ * Since every chunk is self-contained, a corpus can be written and read as a
+ * stream, while the index in the footer gives random access to the layers of a
+ * memory-mapped file.
+ */
+namespace corpus
+{
+
+static_assert(std::endian::native == std::endian::little, "The corpus format is read and written in native byte order, which must be little-endian");
+
+inline constexpr std::array<char, 8> magic{ 'C', 'S', 'P', 'C', 'O', 'R', 'P', 'S' };
+inline constexpr uint32_t version = 1;
+
+struct file_header
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct layer_header
+{
+    uint64_t chunk_size; //!< The size of the chunk in bytes, including this header and the padding at the end.
+    int64_t max_deviation; //!< As requested by the engine for this layer.
+    int64_t max_area_deviation; //!< As requested by the engine for this layer.
+    uint32_t polygon_count;
+    uint32_t path_count;
+};
+
+struct file_footer
+{
+    uint64_t layer_count;
+    std::array<char, 8> magic;
+};
+
+static_assert(sizeof(file_header) == 16 && sizeof(layer_header) == 32 && sizeof(file_footer) == 16, "The corpus headers must not contain padding");
+
+/*!
+ * Read a value from a possibly unaligned position in a buffer.
+ */
+template<class T>
+T load(const std::byte* position) noexcept
+{
+    T value;
+    std::memcpy(&value, position, sizeof(T));
+    return value;
+}
+
+inline uint64_t zigzag(const int64_t value) noexcept
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(const uint64_t value) noexcept
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline void writeVarint(std::vector<std::byte>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<std::byte>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::byte>(value));
+}
+
+/*!
+ * Read a varint, and advance the position past it.
+ * \param position The position to read from. This will be advanced in-place.
+ * \param end The end of the column, which may not be read past.
+ * \return The decoded value.
+ */
+inline uint64_t readVarint(const std::byte*& position, const std::byte* end)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && position != end; shift += 7)
+    {
+        const auto byte = static_cast<uint64_t>(*position++);
+        value |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupt corpus: varint runs past the end of its column");
+}
+
+} // namespace corpus
+
+#endif // CORPUS_FORMAT_H
@@ -0,0 +1,433 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef CORPUS_READER_H
+#define CORPUS_READER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h> // Formatting library
+
+#include "corpus/format.h"
+#include "simplify/point_container.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace corpus
+{
+
+/*!
+ * A view of one encoded path, which decodes its vertices while iterating.
+ *
+ * The coordinates are read straight from the corpus buffer; nothing is copied
+ * or allocated. Since the vertices are delta-encoded, the view can only be
+ * iterated in order. Copy it into a container for random access, e.g. to
+ * simplify it.
+ */
+class path_view
+{
+public:
+    using value_type = geometry::Point;
+    inline static constexpr bool is_closed = true;
+    inline static constexpr direction winding = direction::NA;
+
+    class iterator
+    {
+    public:
+        using value_type = geometry::Point;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::input_iterator_tag;
+
+        iterator() = default;
+
+        iterator(const std::byte* x, const std::byte* x_end, const std::byte* y, const std::byte* y_end, const size_t remaining) : x_{ x }, x_end_{ x_end }, y_{ y }, y_end_{ y_end }, remaining_{ remaining }
+        {
+            decode();
+        }
+
+        const value_type& operator*() const noexcept
+        {
+            return point_;
+        }
+
+        iterator& operator++()
+        {
+            --remaining_;
+            decode();
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept
+        {
+            return it.remaining_ == 0;
+        }
+
+    private:
+        void decode()
+        {
+            if (remaining_ > 0)
+            {
+                // Add in unsigned arithmetic, so that corrupt deltas wrap around instead of overflowing.
+                point_.X = static_cast<int64_t>(static_cast<uint64_t>(point_.X) + static_cast<uint64_t>(unzigzag(readVarint(x_, x_end_))));
+                point_.Y = static_cast<int64_t>(static_cast<uint64_t>(point_.Y) + static_cast<uint64_t>(unzigzag(readVarint(y_, y_end_))));
+            }
+        }
+
+        const std::byte* x_{ nullptr };
+        const std::byte* x_end_{ nullptr };
+        const std::byte* y_{ nullptr };
+        const std::byte* y_end_{ nullptr };
+        size_t remaining_{ 0 };
+        value_type point_{ 0, 0 };
+    };
+
+    path_view(const std::byte* x, const std::byte* x_end, const std::byte* y, const std::byte* y_end, const size_t size) noexcept : x_{ x }, x_end_{ x_end }, y_{ y }, y_end_{ y_end }, size_{ size }
+    {
+    }
+
+    [[nodiscard]] iterator begin() const
+    {
+        return iterator{ x_, x_end_, y_, y_end_, size_ };
+    }
+
+    [[nodiscard]] std::default_sentinel_t end() const noexcept
+    {
+        return std::default_sentinel;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+private:
+    const std::byte* x_;
+    const std::byte* x_end_;
+    const std::byte* y_;
+    const std::byte* y_end_;
+    size_t size_;
+};
+
+/*!
+ * A view of the polygons of one layer in a corpus buffer.
+ */
+class layer_view
+{
+public:
+    /*!
+     * Interpret a chunk of a corpus as a layer, checking that its tables are
+     * consistent and that all paths stay within the chunk.
+     * \param chunk The start of the chunk.
+     * \param available The number of bytes that may be read from the chunk.
+     */
+    layer_view(const std::byte* chunk, const size_t available) : chunk_{ chunk }
+    {
+        if (available < sizeof(layer_header))
+        {
+            throw std::runtime_error("Corrupt corpus: truncated layer header");
+        }
+        header_ = load<layer_header>(chunk);
+        const size_t tables_size = (size_t{ header_.polygon_count } + 1 + header_.path_count + 2 * (size_t{ header_.path_count } + 1)) * sizeof(uint32_t);
+        if (header_.chunk_size > available || sizeof(layer_header) + tables_size > header_.chunk_size)
+        {
+            throw std::runtime_error("Corrupt corpus: layer runs past the end of the file");
+        }
+        polygon_paths_ = chunk + sizeof(layer_header);
+        path_vertices_ = polygon_paths_ + (size_t{ header_.polygon_count } + 1) * sizeof(uint32_t);
+        x_offsets_ = path_vertices_ + size_t{ header_.path_count } * sizeof(uint32_t);
+        y_offsets_ = x_offsets_ + (size_t{ header_.path_count } + 1) * sizeof(uint32_t);
+        x_column_ = y_offsets_ + (size_t{ header_.path_count } + 1) * sizeof(uint32_t);
+        if (table(x_offsets_, header_.path_count) + table(y_offsets_, header_.path_count) > header_.chunk_size - sizeof(layer_header) - tables_size)
+        {
+            throw std::runtime_error("Corrupt corpus: layer columns run past the end of the layer");
+        }
+        y_column_ = x_column_ + table(x_offsets_, header_.path_count);
+
+        // Every polygon has an outline, and every path has at least one byte per coordinate for each of its vertices.
+        if (table(polygon_paths_, 0) != 0 || table(polygon_paths_, header_.polygon_count) != header_.path_count)
+        {
+            throw std::runtime_error("Corrupt corpus: polygons don't cover the paths of the layer");
+        }
+        for (size_t polygon_index = 0; polygon_index < header_.polygon_count; ++polygon_index)
+        {
+            if (table(polygon_paths_, polygon_index + 1) <= table(polygon_paths_, polygon_index))
+            {
+                throw std::runtime_error("Corrupt corpus: polygon without an outline");
+            }
+        }
+        if (table(x_offsets_, 0) != 0 || table(y_offsets_, 0) != 0)
+        {
+            throw std::runtime_error("Corrupt corpus: columns don't start at their first path");
+        }
+        for (size_t path_index = 0; path_index < header_.path_count; ++path_index)
+        {
+            const size_t vertex_count = table(path_vertices_, path_index);
+            if (table(x_offsets_, path_index + 1) < table(x_offsets_, path_index) + vertex_count || table(y_offsets_, path_index + 1) < table(y_offsets_, path_index) + vertex_count)
+            {
+                throw std::runtime_error("Corrupt corpus: path is too short for its vertices");
+            }
+        }
+    }
+
+    [[nodiscard]] int64_t maxDeviation() const noexcept
+    {
+        return header_.max_deviation;
+    }
+
+    [[nodiscard]] int64_t maxAreaDeviation() const noexcept
+    {
+        return header_.max_area_deviation;
+    }
+
+    [[nodiscard]] size_t polygonCount() const noexcept
+    {
+        return header_.polygon_count;
+    }
+
+    /*!
+     * The number of paths in the layer, which are all outlines and holes.
+     */
+    [[nodiscard]] size_t pathCount() const noexcept
+    {
+        return header_.path_count;
+    }
+
+    [[nodiscard]] path_view path(const size_t path_index) const
+    {
+        if (path_index >= header_.path_count)
+        {
+            throw std::out_of_range(fmt::format("Path {} of a layer with {} paths", path_index, header_.path_count));
+        }
+        // The constructor checked that the offsets increase and stay within the columns.
+        const size_t x_begin = table(x_offsets_, path_index);
+        const size_t x_end = table(x_offsets_, path_index + 1);
+        const size_t y_begin = table(y_offsets_, path_index);
+        const size_t y_end = table(y_offsets_, path_index + 1);
+        return path_view{ x_column_ + x_begin, x_column_ + x_end, y_column_ + y_begin, y_column_ + y_end, table(path_vertices_, path_index) };
+    }
+
+    [[nodiscard]] path_view outline(const size_t polygon_index) const
+    {
+        checkPolygon(polygon_index);
+        return path(table(polygon_paths_, polygon_index));
+    }
+
+    [[nodiscard]] size_t holeCount(const size_t polygon_index) const
+    {
+        checkPolygon(polygon_index);
+        return table(polygon_paths_, polygon_index + 1) - table(polygon_paths_, polygon_index) - 1;
+    }
+
+    [[nodiscard]] path_view hole(const size_t polygon_index, const size_t hole_index) const
+    {
+        if (hole_index >= holeCount(polygon_index))
+        {
+            throw std::out_of_range(fmt::format("Hole {} of a polygon with {} holes", hole_index, holeCount(polygon_index)));
+        }
+        return path(table(polygon_paths_, polygon_index) + 1 + hole_index);
+    }
+
+    /*!
+     * The size of the chunk of this layer, in bytes.
+     */
+    [[nodiscard]] size_t chunkSize() const noexcept
+    {
+        return header_.chunk_size;
+    }
+
+private:
+    static size_t table(const std::byte* table, const size_t index) noexcept
+    {
+        return load<uint32_t>(table + index * sizeof(uint32_t));
+    }
+
+    void checkPolygon(const size_t polygon_index) const
+    {
+        if (polygon_index >= header_.polygon_count)
+        {
+            throw std::out_of_range(fmt::format("Polygon {} of a layer with {} polygons", polygon_index, header_.polygon_count));
+        }
+    }
+
+    const std::byte* chunk_;
+    layer_header header_;
+    const std::byte* polygon_paths_;
+    const std::byte* path_vertices_;
+    const std::byte* x_offsets_;
+    const std::byte* y_offsets_;
+    const std::byte* x_column_;
+    const std::byte* y_column_;
+};
+
+/*!
+ * A corpus file that is memory-mapped for random access to its layers.
+ *
+ * Pages are only read from disk when they are accessed, and can be dropped
+ * again by the kernel, so corpora that are larger than memory can be read too.
+ */
+class mapped_corpus
+{
+public:
+    explicit mapped_corpus(const std::filesystem::path& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error(fmt::format("Could not open {}", path.string()));
+        }
+        struct stat status{};
+        if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(file_header) + sizeof(file_footer))
+        {
+            ::close(fd);
+            throw std::runtime_error(fmt::format("{} is not a corpus", path.string()));
+        }
+        size_ = static_cast<size_t>(status.st_size);
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping keeps the file open.
+        if (mapping == MAP_FAILED)
+        {
+            throw std::runtime_error(fmt::format("Could not map {}", path.string()));
+        }
+        data_ = static_cast<const std::byte*>(mapping);
+
+        const auto header = load<file_header>(data_);
+        const auto footer = load<file_footer>(data_ + size_ - sizeof(file_footer));
+        if (header.magic != magic || header.version != version || footer.magic != magic || footer.layer_count > (size_ - sizeof(file_header) - sizeof(file_footer)) / sizeof(uint64_t))
+        {
+            ::munmap(mapping, size_);
+            throw std::runtime_error(fmt::format("{} is not a corpus of version {}, or it was not closed", path.string(), version));
+        }
+        layer_count_ = footer.layer_count;
+        layer_offsets_ = data_ + size_ - sizeof(file_footer) - layer_count_ * sizeof(uint64_t);
+    }
+
+    mapped_corpus(const mapped_corpus&) = delete;
+    mapped_corpus& operator=(const mapped_corpus&) = delete;
+
+    ~mapped_corpus()
+    {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+
+    [[nodiscard]] size_t layerCount() const noexcept
+    {
+        return layer_count_;
+    }
+
+    [[nodiscard]] layer_view layer(const size_t layer_index) const
+    {
+        if (layer_index >= layer_count_)
+        {
+            throw std::out_of_range(fmt::format("Layer {} of a corpus with {} layers", layer_index, layer_count_));
+        }
+        const auto offset = load<uint64_t>(layer_offsets_ + layer_index * sizeof(uint64_t));
+        const auto index_start = static_cast<size_t>(layer_offsets_ - data_);
+        if (offset < sizeof(file_header) || offset >= index_start)
+        {
+            throw std::runtime_error("Corrupt corpus: layer offset outside of the file");
+        }
+        return layer_view{ data_ + offset, index_start - offset };
+    }
+
+    /*!
+     * Tell the kernel that the layers will be read in order, so it reads ahead
+     * and drops pages that were read.
+     */
+    void adviseSequential() const noexcept
+    {
+        ::madvise(const_cast<std::byte*>(data_), size_, MADV_SEQUENTIAL);
+    }
+
+private:
+    const std::byte* data_{ nullptr };
+    size_t size_{ 0 };
+    size_t layer_count_{ 0 };
+    const std::byte* layer_offsets_{ nullptr };
+};
+
+/*!
+ * Reads a corpus one layer at a time, keeping only the current layer in memory.
+ *
+ * Unlike mapped_corpus this doesn't need the index at the end of the file, so
+ * it can also read from pipes and from corpora that are still being written.
+ */
+class corpus_stream
+{
+public:
+    explicit corpus_stream(const std::filesystem::path& path) : in_{ path, std::ios::binary }
+    {
+        file_header header{};
+        if (! in_.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != magic || header.version != version)
+        {
+            throw std::runtime_error(fmt::format("{} is not a corpus of version {}", path.string(), version));
+        }
+    }
+
+    /*!
+     * Read the next layer.
+     * \return Whether there was another layer. If so, it is available through
+     * layer() until the next call.
+     */
+    bool next()
+    {
+        buffer_.resize(sizeof(layer_header));
+        if (! in_.read(reinterpret_cast<char*>(buffer_.data()), sizeof(layer_header)))
+        {
+            return false;
+        }
+        const auto header = load<layer_header>(buffer_.data());
+        if (header.chunk_size < sizeof(layer_header))
+        {
+            return false; // Reached the index, which starts with the offset of the first layer; too small to be a layer.
+        }
+        // Grow the buffer only as the data arrives, so that a corrupt chunk size can't make it allocate more than the file holds.
+        constexpr size_t read_step = size_t{ 1 } << 20;
+        while (buffer_.size() < header.chunk_size)
+        {
+            const size_t offset = buffer_.size();
+            const size_t step = std::min<size_t>(header.chunk_size - offset, read_step);
+            buffer_.resize(offset + step);
+            if (! in_.read(reinterpret_cast<char*>(buffer_.data() + offset), static_cast<std::streamsize>(step)))
+            {
+                throw std::runtime_error("Corrupt corpus: truncated layer");
+            }
+        }
+        layer_.emplace(buffer_.data(), buffer_.size());
+        return true;
+    }
+
+    [[nodiscard]] const layer_view& layer() const
+    {
+        return layer_.value();
+    }
+
+private:
+    std::ifstream in_;
+    std::vector<std::byte> buffer_;
+    std::optional<layer_view> layer_;
+};
+
+} // namespace corpus
+
+#endif // CORPUS_READER_H
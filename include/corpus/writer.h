@@ -0,0 +1,181 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef CORPUS_WRITER_H
+#define CORPUS_WRITER_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h> // Formatting library
+
+#include "corpus/format.h"
+
+namespace corpus
+{
+
+/*!
+ * Writes a polygon corpus, one layer at a time. Only the layer that is being
+ * written is kept in memory.
+ */
+class corpus_writer
+{
+public:
+    /*!
+     * Create a corpus file, overwriting it if it exists.
+     * \param path The file to write.
+     */
+    explicit corpus_writer(const std::filesystem::path& path) : out_{ path, std::ios::binary | std::ios::trunc }
+    {
+        if (! out_)
+        {
+            throw std::runtime_error(fmt::format("Could not open {} for writing", path.string()));
+        }
+        const file_header header{ .magic = magic, .version = version, .reserved = 0 };
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    corpus_writer(const corpus_writer&) = delete;
+    corpus_writer& operator=(const corpus_writer&) = delete;
+
+    ~corpus_writer()
+    {
+        if (! closed_)
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+                // Destructors may not throw. Call close() explicitly to see errors.
+            }
+        }
+    }
+
+    /*!
+     * Append a layer to the corpus.
+     * \param max_deviation The maximum deviation requested for this layer.
+     * \param max_area_deviation The maximum area deviation requested for this
+     * layer.
+     * \param polygons A range of polygons, each of which is a range of paths:
+     * first the outline, then the holes. Each path is a range of points. Every
+     * polygon must have an outline, which may be empty.
+     */
+    void writeLayer(const int64_t max_deviation, const int64_t max_area_deviation, const auto& polygons)
+    {
+        polygon_paths_.clear();
+        path_vertices_.clear();
+        x_offsets_.clear();
+        y_offsets_.clear();
+        x_column_.clear();
+        y_column_.clear();
+
+        for (const auto& polygon : polygons)
+        {
+            const size_t first_path = path_vertices_.size();
+            polygon_paths_.push_back(checkedSize(first_path));
+            for (const auto& path : polygon)
+            {
+                x_offsets_.push_back(checkedSize(x_column_.size()));
+                y_offsets_.push_back(checkedSize(y_column_.size()));
+                int64_t previous_x = 0;
+                int64_t previous_y = 0;
+                uint32_t vertex_count = 0;
+                for (const auto& point : path)
+                {
+                    writeVarint(x_column_, zigzag(point.X - previous_x));
+                    writeVarint(y_column_, zigzag(point.Y - previous_y));
+                    previous_x = point.X;
+                    previous_y = point.Y;
+                    ++vertex_count;
+                }
+                path_vertices_.push_back(vertex_count);
+            }
+            if (path_vertices_.size() == first_path)
+            {
+                throw std::invalid_argument("Every polygon of a corpus layer needs an outline, even if it is empty");
+            }
+        }
+        polygon_paths_.push_back(checkedSize(path_vertices_.size()));
+        x_offsets_.push_back(checkedSize(x_column_.size()));
+        y_offsets_.push_back(checkedSize(y_column_.size()));
+
+        const size_t tables_size = (polygon_paths_.size() + path_vertices_.size() + x_offsets_.size() + y_offsets_.size()) * sizeof(uint32_t);
+        const size_t unpadded_size = sizeof(layer_header) + tables_size + x_column_.size() + y_column_.size();
+        const size_t chunk_size = (unpadded_size + 7) & ~size_t{ 7 }; // Keep the next chunk aligned.
+        const layer_header header{ .chunk_size = chunk_size,
+                                   .max_deviation = max_deviation,
+                                   .max_area_deviation = max_area_deviation,
+                                   .polygon_count = checkedSize(polygon_paths_.size() - 1),
+                                   .path_count = checkedSize(path_vertices_.size()) };
+
+        layer_offsets_.push_back(static_cast<uint64_t>(out_.tellp()));
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeVector(polygon_paths_);
+        writeVector(path_vertices_);
+        writeVector(x_offsets_);
+        writeVector(y_offsets_);
+        writeVector(x_column_);
+        writeVector(y_column_);
+        constexpr std::array<char, 8> padding{};
+        out_.write(padding.data(), static_cast<std::streamsize>(chunk_size - unpadded_size));
+        if (! out_)
+        {
+            throw std::runtime_error("Could not write the corpus layer");
+        }
+    }
+
+    /*!
+     * Write the layer index and close the file.
+     */
+    void close()
+    {
+        closed_ = true;
+        writeVector(layer_offsets_);
+        const file_footer footer{ .layer_count = layer_offsets_.size(), .magic = magic };
+        out_.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+        out_.close();
+        if (! out_)
+        {
+            throw std::runtime_error("Could not finish writing the corpus");
+        }
+    }
+
+private:
+    static uint32_t checkedSize(const size_t size)
+    {
+        if (size > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::length_error("Layer is too large for the corpus format");
+        }
+        return static_cast<uint32_t>(size);
+    }
+
+    template<class T>
+    void writeVector(const std::vector<T>& values)
+    {
+        out_.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    std::ofstream out_;
+    bool closed_{ false };
+    std::vector<uint64_t> layer_offsets_;
+
+    // Buffers of the layer being written, kept to reuse their memory.
+    std::vector<uint32_t> polygon_paths_;
+    std::vector<uint32_t> path_vertices_;
+    std::vector<uint32_t> x_offsets_;
+    std::vector<uint32_t> y_offsets_;
+    std::vector<std::byte> x_column_;
+    std::vector<std::byte> y_column_;
+};
+
+} // namespace corpus
+
+#endif // CORPUS_WRITER_H
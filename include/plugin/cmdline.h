@@ -16,7 +16,7 @@ static const auto VERSION_ID = fmt::format(FMT_COMPILE("{} {}"), NAME, VERSION);
 constexpr std::string_view USAGE = R"({0}.
 
 Usage:
-  simplify_boost_plugin [--address=<address>] [--port=<port>]
+  simplify_boost_plugin [--address=<address>] [--port=<port>] [--vertex-budget=<count>] [--deviation-ceiling=<deviation>] [--trace-file=<path>] [--incremental] [--ready-fd=<fd>] [--ready-stdout] [--drain-timeout=<seconds>] [--record=<path>]
   simplify_boost_plugin (-h | --help)
   simplify_boost_plugin --version
 
@@ -25,6 +25,14 @@ Options:
   --version                 Show version.
   -ip --address=<address>   The IP address to connect the socket to [default: localhost].
   -p --port=<port>          The port number to connect the socket to [default: 33700].
+  --vertex-budget=<count>   The maximum number of vertices per layer, 0 for no limit [default: 0].
+  --deviation-ceiling=<deviation>  The maximum deviation in micron allowed to meet the vertex budget [default: 100].
+  --incremental             Re-simplify only the parts of polygons that changed since the previous layer.
+  --ready-fd=<fd>           Write a line to this inherited file descriptor once ready to accept calls.
+  --ready-stdout            Print a line to stdout once ready to accept calls.
+  --drain-timeout=<seconds>  The time to let calls in flight finish when stopped by SIGINT or SIGTERM [default: 10].
+  --record=<path>           Append every simplify request to this file, to build a polygon corpus from.
+  --trace-file=<path>       The file to write a Chrome trace to on SIGUSR1 and on exit, if tracing is compiled in [default: simplify_trace.json].
 )";
 
 } // namespace plugin::cmdline
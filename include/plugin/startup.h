@@ -0,0 +1,129 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef PLUGIN_STARTUP_H
+#define PLUGIN_STARTUP_H
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include <spdlog/spdlog.h> // Logging library
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define PLUGIN_STARTUP_POSIX
+#endif
+
+namespace plugin::startup
+{
+
+/*!
+ * Measures how long each phase of the startup of the plugin takes.
+ */
+class phase_timer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    phase_timer() noexcept : start_{ clock::now() }, last_{ start_ }
+    {
+    }
+
+    /*!
+     * Mark the end of a phase, which started at the end of the previous phase.
+     * \param name The name of the phase that ended.
+     */
+    void phase(const std::string_view name)
+    {
+        const auto now = clock::now();
+        spdlog::debug("Startup phase {} took {:.3f} ms", name, std::chrono::duration<double, std::milli>(now - last_).count());
+        last_ = now;
+    }
+
+    /*!
+     * The time since the timer was constructed, in milliseconds.
+     */
+    [[nodiscard]] double elapsed() const
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - start_).count();
+    }
+
+private:
+    clock::time_point start_;
+    clock::time_point last_;
+};
+
+/*!
+ * Write a readiness line to a file descriptor inherited from the parent
+ * process, then close it. The parent can block on reading the other end of a
+ * pipe instead of polling the handshake.
+ * \param fd The file descriptor to write to.
+ * \param address The address the server listens on.
+ */
+inline void notifyFd(const int fd, const std::string_view address)
+{
+#ifdef PLUGIN_STARTUP_POSIX
+    const auto line = fmt::format("READY {}\n", address);
+    if (::write(fd, line.data(), line.size()) != static_cast<ssize_t>(line.size()))
+    {
+        spdlog::warn("Could not write readiness to file descriptor {}: {}", fd, std::strerror(errno));
+    }
+    ::close(fd);
+#else
+    spdlog::warn("Readiness notification over a file descriptor is not supported on this platform");
+#endif
+}
+
+/*!
+ * Notify a service manager that implements the sd_notify protocol, if the
+ * NOTIFY_SOCKET environment variable tells where to.
+ */
+inline void notifyServiceManager()
+{
+    const char* notify_socket = std::getenv("NOTIFY_SOCKET");
+    if (notify_socket == nullptr || notify_socket[0] == '\0')
+    {
+        return;
+    }
+#ifdef PLUGIN_STARTUP_POSIX
+    sockaddr_un socket_address{};
+    socket_address.sun_family = AF_UNIX;
+    const size_t length = std::strlen(notify_socket);
+    if (length >= sizeof(socket_address.sun_path))
+    {
+        spdlog::warn("NOTIFY_SOCKET is too long: {}", notify_socket);
+        return;
+    }
+    std::memcpy(socket_address.sun_path, notify_socket, length);
+    if (socket_address.sun_path[0] == '@') // Abstract namespace socket.
+    {
+        socket_address.sun_path[0] = '\0';
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        spdlog::warn("Could not create the notify socket: {}", std::strerror(errno));
+        return;
+    }
+    constexpr std::string_view message = "READY=1";
+    if (::sendto(fd, message.data(), message.size(), 0, reinterpret_cast<const sockaddr*>(&socket_address), static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + length)) < 0)
+    {
+        spdlog::warn("Could not notify {}: {}", notify_socket, std::strerror(errno));
+    }
+    ::close(fd);
+#else
+    spdlog::warn("NOTIFY_SOCKET is not supported on this platform");
+#endif
+}
+
+} // namespace plugin::startup
+
+#endif // PLUGIN_STARTUP_H
@@ -0,0 +1,243 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef PLUGIN_TRACE_H
+#define PLUGIN_TRACE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h> // Formatting library
+
+/*!
+ * Scoped tracing of the hot path of the plugin.
+ *
+ * Tracing is compiled in only when PLUGIN_TRACING is defined (see the
+ * ENABLE_TRACING CMake option), otherwise spans compile to nothing. Each thread
+ * records its spans in its own ring buffer, so recording a span takes no locks
+ * and does not allocate. The buffers can be exported as Chrome trace JSON, which
+ * can be opened in chrome://tracing or Perfetto next to the engine's traces.
+ */
+namespace plugin::trace
+{
+
+#ifdef PLUGIN_TRACING
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+/*!
+ * The number of spans kept per thread. Older spans are overwritten.
+ */
+inline constexpr size_t capacity = 1 << 14;
+
+/*!
+ * A finished span, as it is stored in the ring buffer.
+ */
+struct event
+{
+    const char* name{ nullptr }; //!< Must be a string literal, since only the pointer is stored.
+    int64_t start_ns{ 0 };
+    int64_t duration_ns{ 0 };
+    size_t vertices{ 0 };
+    std::array<char, 40> uuid{}; //!< Fits a cura-engine-uuid without allocating.
+};
+
+/*!
+ * The spans of one thread. Only the owning thread writes to it.
+ */
+struct ring_buffer
+{
+    std::array<event, capacity> events{};
+    std::atomic<size_t> head{ 0 }; //!< The total number of spans written so far.
+    size_t thread_id{ 0 };
+};
+
+/*!
+ * Keeps the ring buffers of all threads alive, so that they can be exported
+ * after their threads have finished.
+ */
+struct registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ring_buffer>> buffers;
+
+    static registry& instance()
+    {
+        static registry the_registry;
+        return the_registry;
+    }
+};
+
+/*!
+ * Get the ring buffer of the calling thread. It is allocated and registered on
+ * the first span of the thread; after that this is just a thread local lookup.
+ */
+inline ring_buffer& threadBuffer()
+{
+    thread_local ring_buffer* buffer = []
+    {
+        auto& reg = registry::instance();
+        std::scoped_lock lock{ reg.mutex };
+        auto& created = reg.buffers.emplace_back(std::make_unique<ring_buffer>());
+        created->thread_id = reg.buffers.size();
+        return created.get();
+    }();
+    return *buffer;
+}
+
+inline int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef PLUGIN_TRACING
+/*!
+ * Records the time between its construction and destruction as a span.
+ */
+class span
+{
+public:
+    /*!
+     * Start a span.
+     * \param name The name of the span. Must be a string literal.
+     */
+    explicit span(const char* name) noexcept : start_ns_{ now() }
+    {
+        event_.name = name;
+    }
+
+    span(const span&) = delete;
+    span& operator=(const span&) = delete;
+
+    ~span()
+    {
+        event_.start_ns = start_ns_;
+        event_.duration_ns = now() - start_ns_;
+        auto& buffer = threadBuffer();
+        const size_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % capacity] = event_;
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+    /*!
+     * Tag the span with the uuid of the engine that made the request.
+     */
+    void uuid(const std::string_view uuid) noexcept
+    {
+        const size_t length = std::min(uuid.size(), event_.uuid.size() - 1);
+        std::copy_n(uuid.begin(), length, event_.uuid.begin());
+        event_.uuid[length] = '\0';
+    }
+
+    /*!
+     * Tag the span with the number of vertices it processed.
+     */
+    void vertices(const size_t vertices) noexcept
+    {
+        event_.vertices = vertices;
+    }
+
+private:
+    int64_t start_ns_;
+    event event_{};
+};
+#else
+class span
+{
+public:
+    constexpr explicit span(const char*) noexcept
+    {
+    }
+
+    constexpr void uuid(const std::string_view) noexcept
+    {
+    }
+
+    constexpr void vertices(const size_t) noexcept
+    {
+    }
+};
+#endif
+
+/*!
+ * Escape a string for use inside a JSON string literal.
+ *
+ * The uuid of a span comes from the client metadata, so it can hold any
+ * character.
+ */
+inline std::string escapeJson(const std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char character : text)
+    {
+        switch (character)
+        {
+        case '"':
+            escaped += R"(\")";
+            break;
+        case '\\':
+            escaped += R"(\\)";
+            break;
+        default:
+            if (static_cast<unsigned char>(character) < 0x20)
+            {
+                escaped += fmt::format("\\u{:04x}", static_cast<unsigned char>(character));
+            }
+            else
+            {
+                escaped += character;
+            }
+        }
+    }
+    return escaped;
+}
+
+/*!
+ * Write the spans of all threads as Chrome trace JSON.
+ *
+ * Spans that are recorded on other threads while exporting may show up torn,
+ * so preferably export from the thread that runs the handlers.
+ * \param out The stream to write the trace to.
+ * \param process_name The name to show for this process in the trace viewer.
+ */
+inline void writeChromeTrace(std::ostream& out, const std::string_view process_name)
+{
+    out << R"({"traceEvents":[)";
+    out << fmt::format(R"({{"name":"process_name","ph":"M","pid":0,"tid":0,"args":{{"name":"{}"}}}})", escapeJson(process_name));
+
+    auto& reg = registry::instance();
+    std::scoped_lock lock{ reg.mutex };
+    for (const auto& buffer : reg.buffers)
+    {
+        const size_t head = buffer->head.load(std::memory_order_acquire);
+        for (size_t i = head > capacity ? head - capacity : 0; i < head; ++i)
+        {
+            const auto& recorded = buffer->events[i % capacity];
+            out << fmt::format(
+                R"(,{{"name":"{}","cat":"simplify","ph":"X","pid":0,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{"uuid":"{}","vertices":{}}}}})",
+                escapeJson(recorded.name),
+                buffer->thread_id,
+                static_cast<double>(recorded.start_ns) / 1000.0,
+                static_cast<double>(recorded.duration_ns) / 1000.0,
+                escapeJson(recorded.uuid.data()),
+                recorded.vertices);
+        }
+    }
+    out << "]}\n";
+}
+
+} // namespace plugin::trace
+
+#endif // PLUGIN_TRACE_H
@@ -28,16 +28,10 @@ concept closable = requires(T t)
 };
 
 template<class T>
-concept is_closed_point_container = closable<T> && requires(T t)
-{
-    t.is_closed == true;
-};
+concept is_closed_point_container = closable<T> && std::remove_cvref_t<T>::is_closed;
 
 template<class T>
-concept is_open_point_container = closable<T> && requires(T t)
-{
-    t.is_closed == false;
-};
+concept is_open_point_container = closable<T> && ! std::remove_cvref_t<T>::is_closed;
 
 template<class T>
 concept directional = requires(T t)
@@ -46,16 +40,10 @@ concept directional = requires(T t)
 };
 
 template<class T>
-concept is_clockwise_point_container = directional<T> && requires(T t)
-{
-    t.winding == direction::CW;
-};
+concept is_clockwise_point_container = directional<T> && std::remove_cvref_t<T>::winding == direction::CW;
 
 template<class T>
-concept is_counterclockwise_point_container = directional<T> && requires(T t)
-{
-    t.winding == direction::CCW;
-};
+concept is_counterclockwise_point_container = directional<T> && std::remove_cvref_t<T>::winding == direction::CCW;
 
 template<class T>
 concept point2d_named = requires(T point)
@@ -0,0 +1,171 @@
+// Copyright (c) 2023 UltiMaker
+// CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SIMPLIFY_INCREMENTAL_H
+#define UTILS_SIMPLIFY_INCREMENTAL_H
+
+#include <algorithm>
+#include <vector>
+
+#include "simplify/simplify.h"
+
+/*!
+ * What is remembered of the previous simplification of a polygonal chain, so
+ * that the next, slightly different chain can be simplified incrementally.
+ * \tparam Polygonal A polygonal object, which is a list of vertices.
+ */
+template<concepts::poly_range Polygonal>
+struct incremental_state
+{
+    int64_t max_resolution{ 0 };
+    int64_t max_deviation{ 0 };
+    int64_t max_area_deviation{ 0 };
+
+    /*!
+     * The previous input.
+     */
+    Polygonal input;
+
+    /*!
+     * The previous input after simplification, before the deleted vertices
+     * were removed. Remaining vertices may have been shifted.
+     */
+    Polygonal marked;
+
+    /*!
+     * For each vertex of the previous input, whether it was deleted.
+     */
+    std::vector<bool> to_delete;
+
+    /*!
+     * The kept vertices that anchored the range that was simplified again the
+     * last time the chain changed, indexed in the current input. Everything
+     * outside of them was re-used. Both are 0 if the chain was simplified from
+     * scratch.
+     */
+    size_t window_begin{ 0 };
+    size_t window_end{ 0 };
+};
+
+/*!
+ * Simplify a polygonal chain, re-using the simplification of the previous
+ * chain where the two are equal.
+ *
+ * The new chain is compared with the previous one to find the longest common
+ * prefix and suffix. The vertices that were kept in those parts, apart from a
+ * safety margin next to the changed range, are re-used as they are. Only the
+ * changed range plus the margin is simplified again, as a polyline that is
+ * anchored at the re-used vertices on both sides. If the chains differ too
+ * much, or the simplification settings changed, the chain is simplified from
+ * scratch.
+ *
+ * The result may differ from simplifying from scratch, since vertices outside of
+ * the margin are not reconsidered. Outside of the re-simplified range it deviates
+ * no more than the simplification of the previous chain did, and inside of it no
+ * more than simplifying the range on its own.
+ * \tparam Polygonal A polygonal object, which is a list of vertices.
+ * \param simplifier The simplifier with the settings to use.
+ * \param polygon The polygonal chain to simplify.
+ * \param state The state of the previous simplification of this chain. This
+ * will be updated in-place.
+ * \param margin The number of unchanged vertices on either side of the changed
+ * range that are simplified again.
+ * \return A simplified polygonal chain.
+ */
+template<concepts::poly_range Polygonal>
+Polygonal simplifyIncremental(Simplify& simplifier, const Polygonal& polygon, incremental_state<Polygonal>& state, const size_t margin = 16)
+{
+    const auto from_scratch = [&]()
+    {
+        auto [marked, to_delete] = simplifier.mark(polygon);
+        state = incremental_state<Polygonal>{ .max_resolution = simplifier.max_resolution,
+                                              .max_deviation = simplifier.max_deviation,
+                                              .max_area_deviation = simplifier.max_area_deviation,
+                                              .input = polygon,
+                                              .marked = std::move(marked),
+                                              .to_delete = std::move(to_delete) };
+        return Simplify::compact(state.marked, state.to_delete);
+    };
+
+    if (state.max_resolution != simplifier.max_resolution || state.max_deviation != simplifier.max_deviation || state.max_area_deviation != simplifier.max_area_deviation)
+    {
+        return from_scratch();
+    }
+
+    const auto& previous = state.input;
+    const size_t common = std::min(previous.size(), polygon.size());
+    const size_t prefix = std::mismatch(previous.begin(), previous.begin() + common, polygon.begin()).first - previous.begin();
+    if (prefix == previous.size() && prefix == polygon.size())
+    {
+        return Simplify::compact(state.marked, state.to_delete); // Unchanged since the previous layer.
+    }
+    const size_t suffix = std::mismatch(previous.rbegin(), previous.rbegin() + (common - prefix), polygon.rbegin()).first - previous.rbegin();
+    if (prefix <= margin || suffix <= margin || (prefix + suffix - 2 * margin) * 2 < polygon.size())
+    {
+        return from_scratch(); // Too little in common to be worth it.
+    }
+
+    // Find the kept vertices just outside of the margin, which anchor the re-simplified range.
+    const size_t previous_end = previous.size() - suffix + margin;
+    size_t before = prefix - margin;
+    while (before > 0 && state.to_delete[before - 1])
+    {
+        --before;
+    }
+    size_t after = previous_end;
+    while (after < previous.size() && state.to_delete[after])
+    {
+        ++after;
+    }
+    if (before == 0 || after == previous.size())
+    {
+        return from_scratch();
+    }
+    --before; // The last kept vertex of the prefix.
+    const size_t after_new = after + polygon.size() - previous.size(); // The same anchor, indexed in the new chain.
+
+    // Simplify the changed range as a polyline, so that both anchors are retained.
+    geometry::polyline<typename Polygonal::value_type> window;
+    window.emplace_back(state.marked[before]);
+    for (size_t i = before + 1; i < after_new; ++i)
+    {
+        window.emplace_back(polygon[i]);
+    }
+    window.emplace_back(state.marked[after]);
+    const auto [window_marked, window_to_delete] = simplifier.mark(window);
+
+    Polygonal marked;
+    std::vector<bool> to_delete;
+    marked.reserve(polygon.size());
+    to_delete.reserve(polygon.size());
+    for (size_t i = 0; i <= before; ++i)
+    {
+        marked.emplace_back(state.marked[i]);
+        to_delete.emplace_back(state.to_delete[i]);
+    }
+    for (size_t i = 1; i + 1 < window.size(); ++i)
+    {
+        marked.emplace_back(window_marked[i]);
+        to_delete.emplace_back(window_to_delete[i]);
+    }
+    for (size_t i = after; i < previous.size(); ++i)
+    {
+        marked.emplace_back(state.marked[i]);
+        to_delete.emplace_back(state.to_delete[i]);
+    }
+
+    constexpr size_t min_size = concepts::is_closed_point_container<Polygonal> ? 3 : 2;
+    if (static_cast<size_t>(std::count(to_delete.begin(), to_delete.end(), false)) < min_size)
+    {
+        return from_scratch(); // The anchors alone don't make a valid chain.
+    }
+
+    state.input = polygon;
+    state.marked = std::move(marked);
+    state.to_delete = std::move(to_delete);
+    state.window_begin = before;
+    state.window_end = after_new;
+    return Simplify::compact(state.marked, state.to_delete);
+}
+
+#endif // UTILS_SIMPLIFY_INCREMENTAL_H
@@ -4,7 +4,12 @@
 #ifndef UTILS_SIMPLIFY_H
 #define UTILS_SIMPLIFY_H
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <queue>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "simplify/point_container.h"
@@ -51,22 +56,42 @@ public:
      * \return A simplified polygonal chain.
      */
     concepts::poly_range auto simplify(const concepts::poly_range auto& polygon)
+    {
+        const auto [result, to_delete] = mark(polygon);
+
+        // Now remove the marked vertices in one sweep.
+        return compact(result, to_delete);
+    }
+
+    /*!
+     * Run the simplification algorithm, but only mark the vertices that are to
+     * be deleted instead of removing them.
+     *
+     * This keeps the vertex indices of the result equal to those of the input,
+     * so that callers can tell which input vertices survived.
+     * \tparam Polygonal A polygonal object, which is a list of vertices.
+     * \param polygon The polygonal chain to simplify.
+     * \return A copy of the polygonal chain in which the remaining vertices may
+     * have been shifted, and for each vertex whether it is to be deleted.
+     */
+    auto mark(const concepts::poly_range auto& polygon)
     {
         using Polygonal = decltype(polygon);
         using poly_t = std::remove_cvref_t<Polygonal>;
         constexpr bool is_closed = concepts::is_closed_point_container<Polygonal>;
         constexpr size_t min_size = is_closed ? 3 : 2;
 
+        poly_t result(polygon); // Make a copy so that we can also shift vertices.
         if (polygon.size() < min_size) // For polygon, 2 or fewer vertices is degenerate. Delete it. For polyline, 1 vertex is degenerate.
         {
-            return poly_t{};
+            return std::make_pair(result, std::vector<bool>(polygon.size(), true));
         }
+        std::vector<bool> to_delete(polygon.size(), false);
         if (polygon.size() == min_size) // For polygon, don't reduce below 3. For polyline, not below 2.
         {
-            return polygon;
+            return std::make_pair(result, to_delete);
         }
 
-        std::vector<bool> to_delete(polygon.size(), false);
         auto comparator = [](const std::pair<size_t, int64_t>& vertex_a, const std::pair<size_t, int64_t>& vertex_b) { return vertex_a.second > vertex_b.second || (vertex_a.second == vertex_b.second && vertex_a.first > vertex_b.first); };
         std::priority_queue<std::pair<size_t, int64_t>, std::vector<std::pair<size_t, int64_t>>, decltype(comparator)> by_importance(comparator);
 
@@ -78,7 +103,6 @@ public:
         }
 
         // Iteratively remove the least important point until a threshold.
-        poly_t result(polygon); // Make a copy so that we can also shift vertices.
         int64_t vertex_importance = 0;
         while (by_importance.size() > min_size)
         {
@@ -98,22 +122,206 @@ public:
                 remove(result, to_delete, vertex.first, vertex_importance);
             }
         }
+        return std::make_pair(result, to_delete);
+    }
 
-        // Now remove the marked vertices in one sweep.
-        poly_t filtered;
-        for (size_t i = 0; i < result.size(); ++i)
+    /*!
+     * Remove the vertices that are marked for deletion in one sweep.
+     * \param polygon The polygonal chain to remove vertices from.
+     * \param to_delete For each vertex, whether it is to be deleted.
+     * \return A copy of the polygonal chain without the deleted vertices.
+     */
+    static auto compact(const concepts::poly_range auto& polygon, const std::vector<bool>& to_delete)
+    {
+        std::remove_cvref_t<decltype(polygon)> filtered;
+        for (size_t i = 0; i < polygon.size(); ++i)
         {
             if (! to_delete[i])
             {
-                filtered.emplace_back(result[i]);
+                filtered.emplace_back(polygon[i]);
             }
         }
-
         return filtered;
     }
 
+    /*!
+     * Simplify all polygonal chains of a layer, then keep removing the
+     * vertices that cause the least deviation across all of them until the
+     * layer fits in a vertex budget.
+     *
+     * Every chain is first simplified as usual. If the layer still holds more
+     * vertices than the budget allows, the remaining vertices of all chains are
+     * ranked together by how far the input would deviate from the chain if they
+     * were removed, and removed one by one, cheapest first. A vertex is never
+     * removed if that would let the input deviate more than the deviation
+     * ceiling, so the budget may not always be met.
+     * \tparam Polygonal A polygonal object, which is a list of vertices.
+     * \param polygons The polygonal chains of a layer to simplify.
+     * \param vertex_budget The maximum number of vertices to keep for the whole
+     * layer, or 0 to not limit the number of vertices.
+     * \param deviation_ceiling Vertices that would cause a deviation larger than
+     * this are never removed to meet the budget.
+     * \return The simplified polygonal chains, in the same order as the input.
+     */
+    template<concepts::poly_range Polygonal>
+    std::vector<Polygonal> simplifyToBudget(const std::vector<Polygonal>& polygons, const size_t vertex_budget, const int64_t deviation_ceiling)
+    {
+        auto [result, to_delete] = markToBudget(polygons, vertex_budget, deviation_ceiling);
+        for (size_t polygon_index = 0; polygon_index < result.size(); ++polygon_index)
+        {
+            result[polygon_index] = compact(result[polygon_index], to_delete[polygon_index]);
+        }
+        return result;
+    }
+
+    /*!
+     * Run the budgeted simplification of a layer, but only mark the vertices
+     * that are to be deleted instead of removing them, like mark() does for a
+     * single chain.
+     * \tparam Polygonal A polygonal object, which is a list of vertices.
+     * \param polygons The polygonal chains of a layer to simplify.
+     * \param vertex_budget The maximum number of vertices to keep for the whole
+     * layer, or 0 to not limit the number of vertices.
+     * \param deviation_ceiling Vertices that would cause a deviation larger than
+     * this are never removed to meet the budget.
+     * \return Copies of the polygonal chains in which the remaining vertices may
+     * have been shifted, and for each vertex of each chain whether it is to be
+     * deleted.
+     */
+    template<concepts::poly_range Polygonal>
+    std::pair<std::vector<Polygonal>, std::vector<std::vector<bool>>> markToBudget(const std::vector<Polygonal>& polygons, const size_t vertex_budget, const int64_t deviation_ceiling)
+    {
+        constexpr size_t min_size = concepts::is_closed_point_container<Polygonal> ? 3 : 2;
+
+        std::vector<Polygonal> result;
+        result.reserve(polygons.size());
+        std::vector<std::vector<bool>> to_delete;
+        to_delete.reserve(polygons.size());
+        std::vector<size_t> remaining;
+        remaining.reserve(polygons.size());
+        size_t vertex_count = 0;
+        for (const auto& polygon : polygons)
+        {
+            auto [marked, marked_to_delete] = mark(polygon);
+            remaining.push_back(static_cast<size_t>(std::ranges::count(marked_to_delete, false)));
+            vertex_count += remaining.back();
+            result.push_back(std::move(marked));
+            to_delete.push_back(std::move(marked_to_delete));
+        }
+        if (vertex_budget == 0 || vertex_count <= vertex_budget)
+        {
+            return std::make_pair(std::move(result), std::move(to_delete));
+        }
+
+        // Rank the vertices of all chains together, so that the budget is spent where it matters the most.
+        struct ranked_vertex
+        {
+            size_t polygon;
+            size_t vertex;
+            double deviation;
+        };
+        auto comparator = [](const ranked_vertex& vertex_a, const ranked_vertex& vertex_b)
+        { return vertex_a.deviation > vertex_b.deviation || (vertex_a.deviation == vertex_b.deviation && std::tie(vertex_a.polygon, vertex_a.vertex) > std::tie(vertex_b.polygon, vertex_b.vertex)); };
+        std::priority_queue<ranked_vertex, std::vector<ranked_vertex>, decltype(comparator)> by_deviation(comparator);
+        auto rank = [&](const size_t polygon_index, const size_t vertex_index)
+        {
+            const double vertex_deviation = removalDeviation(polygons[polygon_index], result[polygon_index], to_delete[polygon_index], vertex_index);
+            if (vertex_deviation <= static_cast<double>(deviation_ceiling))
+            {
+                by_deviation.push(ranked_vertex{ polygon_index, vertex_index, vertex_deviation });
+            }
+        };
+
+        for (size_t polygon_index = 0; polygon_index < result.size(); ++polygon_index)
+        {
+            if (remaining[polygon_index] <= min_size)
+            {
+                continue; // Can't be reduced any further.
+            }
+            for (size_t i = 0; i < result[polygon_index].size(); ++i)
+            {
+                if (! to_delete[polygon_index][i])
+                {
+                    rank(polygon_index, i);
+                }
+            }
+        }
+
+        while (vertex_count > vertex_budget && ! by_deviation.empty())
+        {
+            const ranked_vertex vertex = by_deviation.top();
+            by_deviation.pop();
+            auto& polygon_to_delete = to_delete[vertex.polygon];
+            if (polygon_to_delete[vertex.vertex] || remaining[vertex.polygon] <= min_size)
+            {
+                continue;
+            }
+            // Whenever a vertex is removed its neighbours are ranked again, so an entry that no longer matches is outdated.
+            if (removalDeviation(polygons[vertex.polygon], result[vertex.polygon], polygon_to_delete, vertex.vertex) != vertex.deviation)
+            {
+                continue;
+            }
+
+            polygon_to_delete[vertex.vertex] = true;
+            --remaining[vertex.polygon];
+            --vertex_count;
+            if (remaining[vertex.polygon] > min_size)
+            {
+                rank(vertex.polygon, previousNotDeleted(vertex.vertex, polygon_to_delete));
+                rank(vertex.polygon, nextNotDeleted(vertex.vertex, polygon_to_delete));
+            }
+        }
+        return std::make_pair(std::move(result), std::move(to_delete));
+    }
+
+    /*!
+     * How far the input would deviate from a marked chain if one more vertex
+     * were removed from it.
+     *
+     * This is the largest distance from the segment that would replace the
+     * vertex to any input vertex that is removed between its neighbours,
+     * including the ones that were removed before.
+     * \param input The chain before simplification.
+     * \param marked The chain as marked by mark(), with the same vertex indices
+     * as the input.
+     * \param to_delete For each vertex, whether it is deleted already.
+     * \param index The vertex to remove.
+     * \return The deviation, or infinity if the vertex must be retained.
+     */
+    static double removalDeviation(const concepts::poly_range auto& input, const concepts::poly_range auto& marked, const std::vector<bool>& to_delete, const size_t index)
+    {
+        constexpr bool is_closed = concepts::is_closed_point_container<decltype(marked)>;
+        if (! is_closed && (index == 0 || index == marked.size() - 1))
+        {
+            return std::numeric_limits<double>::infinity(); // Endpoints of the polyline must always be retained.
+        }
+        const size_t before_index = previousNotDeleted(index, to_delete);
+        const size_t after_index = nextNotDeleted(index, to_delete);
+        double largest = 0.0;
+        for (size_t i = (before_index + 1) % marked.size(); i != after_index; i = (i + 1) % marked.size())
+        {
+            largest = std::max(largest, getDistFromSegment(input[i], marked[before_index], marked[after_index]));
+        }
+        return largest;
+    }
+
 private:
 
+    /*!
+     * The distance from a point to a line segment, rather than to the infinite
+     * line through it.
+     */
+    static double getDistFromSegment(const geometry::Point& p, const geometry::Point& a, const geometry::Point& b)
+    {
+        const double ab_x = static_cast<double>(b.X) - static_cast<double>(a.X);
+        const double ab_y = static_cast<double>(b.Y) - static_cast<double>(a.Y);
+        const double ap_x = static_cast<double>(p.X) - static_cast<double>(a.X);
+        const double ap_y = static_cast<double>(p.Y) - static_cast<double>(a.Y);
+        const double length2 = ab_x * ab_x + ab_y * ab_y;
+        const double t = length2 == 0.0 ? 0.0 : std::clamp((ap_x * ab_x + ap_y * ab_y) / length2, 0.0, 1.0);
+        return std::hypot(ap_x - t * ab_x, ap_y - t * ab_y);
+    }
+
     static auto getDistFromLine(const geometry::Point& p, const geometry::Point& a, const geometry::Point& b)
     {
         //  x.......a------------b
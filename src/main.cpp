@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <map>
 #include <optional>
 #include <thread>
@@ -6,16 +10,21 @@
 #include <agrpc/asio_grpc.hpp>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
+#include <boost/asio/redirect_error.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <docopt/docopt.h> // Library for parsing command line arguments
 #include <fmt/format.h> // Formatting library
 #include <fmt/ranges.h> // Formatting library for ranges
 #include <google/protobuf/empty.pb.h>
+#include <google/protobuf/util/delimited_message_util.h>
 #include <grpcpp/server.h>
 #include <grpcpp/server_builder.h>
 #include <spdlog/spdlog.h> // Logging library
 
 #include "plugin/cmdline.h" // Custom command line argument definitions
+#include "plugin/startup.h" // Startup measurements and readiness notification
+#include "plugin/trace.h" // Scoped tracing of the hot path
+#include "simplify/incremental.h" // Re-simplify only what changed since the previous layer
 #include "simplify/simplify.h" // Custom utilities for simplifying code
 
 #include "cura/plugins/slots/broadcast/v0/broadcast.grpc.pb.h"
@@ -38,15 +47,40 @@ static plugin_metadata metadata{};
 
 int main(int argc, const char** argv)
 {
+    plugin::startup::phase_timer startup;
     spdlog::set_level(spdlog::level::debug);
     constexpr bool show_help = true;
     const std::map<std::string, docopt::value> args = docopt::docopt(fmt::format(plugin::cmdline::USAGE, plugin::cmdline::NAME), { argv + 1, argv + argc }, show_help, plugin::cmdline::VERSION_ID);
 
+    const auto vertex_budget = static_cast<size_t>(args.at("--vertex-budget").asLong());
+    const auto deviation_ceiling = static_cast<int64_t>(args.at("--deviation-ceiling").asLong());
+    if (vertex_budget > 0)
+    {
+        spdlog::info("Simplifying to a budget of {} vertices per layer, with a deviation ceiling of {}", vertex_budget, deviation_ceiling);
+    }
+
+    const bool incremental = args.at("--incremental").asBool() && vertex_budget == 0;
+    if (args.at("--incremental").asBool() && vertex_budget > 0)
+    {
+        spdlog::warn("Incremental simplification is not used together with a vertex budget");
+    }
+
+    const auto trace_path = args.at("--trace-file").asString();
+    const auto drain_timeout = std::chrono::seconds(args.at("--drain-timeout").asLong());
+    std::optional<std::ofstream> recording;
+    if (const auto& record_path = args.at("--record"))
+    {
+        recording.emplace(record_path.asString(), std::ios::binary | std::ios::app);
+        spdlog::info("Recording simplify requests to {}", record_path.asString());
+    }
+    const auto address = fmt::format("{}:{}", args.at("--address").asString(), args.at("--port").asString());
+    startup.phase("parse_arguments");
+
     std::unique_ptr<grpc::Server> server;
 
     grpc::ServerBuilder builder;
     agrpc::GrpcContext grpc_context{ builder.AddCompletionQueue() };
-    builder.AddListeningPort(fmt::format("{}:{}", args.at("--address").asString(), args.at("--port").asString()), grpc::InsecureServerCredentials());
+    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
 
     cura::plugins::slots::handshake::v0::HandshakeService::AsyncService handshake_service;
     builder.RegisterService(&handshake_service);
@@ -58,20 +92,30 @@ int main(int argc, const char** argv)
     builder.RegisterService(&service);
 
     server = builder.BuildAndStart();
+    startup.phase("start_server");
 
     // Start the handshake process
     boost::asio::co_spawn(
         grpc_context,
         [&]() -> boost::asio::awaitable<void>
         {
+            bool first_handshake = true;
             while (true)
             {
                 grpc::ServerContext server_context;
 
                 cura::plugins::slots::handshake::v0::CallRequest request;
                 grpc::ServerAsyncResponseWriter<cura::plugins::slots::handshake::v0::CallResponse> writer{ &server_context };
-                co_await agrpc::request(&cura::plugins::slots::handshake::v0::HandshakeService::AsyncService::RequestCall, handshake_service, server_context, request, writer, boost::asio::use_awaitable);
+                if (! co_await agrpc::request(&cura::plugins::slots::handshake::v0::HandshakeService::AsyncService::RequestCall, handshake_service, server_context, request, writer, boost::asio::use_awaitable))
+                {
+                    co_return; // The server is shutting down.
+                }
                 spdlog::info("Received handshake request");
+                if (first_handshake)
+                {
+                    spdlog::info("First handshake received {:.3f} ms after starting", startup.elapsed());
+                    first_handshake = false;
+                }
                 spdlog::info("Slot ID: {}, version_range: {}", static_cast<int>(request.slot_id()), request.version_range());
 
                 cura::plugins::slots::handshake::v0::CallResponse response;
@@ -86,6 +130,17 @@ int main(int argc, const char** argv)
         },
         boost::asio::detached);
 
+    // The previous layer of each client, for incremental simplification. Clients don't say when they are done, so only the
+    // most recently active ones are kept, and a client's layer is dropped when it broadcasts its settings for a new slice.
+    struct previous_layer
+    {
+        std::vector<incremental_state<geometry::polygon_outer<>>> chains; // By index of the outline or hole in the layer.
+        uint64_t last_used{ 0 };
+    };
+    constexpr size_t max_previous_layers = 4;
+    std::unordered_map<std::string, previous_layer> previous_layers;
+    uint64_t previous_layers_clock = 0;
+
     // Listen to the Broadcast channel
     std::unordered_map<std::string, std::unordered_map<std::string, std::string>> settings;
     boost::asio::co_spawn(grpc_context,
@@ -96,7 +151,10 @@ int main(int argc, const char** argv)
                                   grpc::ServerContext server_context;
                                   cura::plugins::slots::broadcast::v0::BroadcastServiceSettingsRequest request;
                                   grpc::ServerAsyncResponseWriter<google::protobuf::Empty> writer{ &server_context };
-                                  co_await agrpc::request(&cura::plugins::slots::broadcast::v0::BroadcastService::AsyncService::RequestBroadcastSettings, broadcast_service, server_context, request, writer, boost::asio::use_awaitable);
+                                  if (! co_await agrpc::request(&cura::plugins::slots::broadcast::v0::BroadcastService::AsyncService::RequestBroadcastSettings, broadcast_service, server_context, request, writer, boost::asio::use_awaitable))
+                                  {
+                                      co_return; // The server is shutting down.
+                                  }
                                   google::protobuf::Empty response{};
                                   co_await agrpc::finish(writer, response, grpc::Status::OK, boost::asio::use_awaitable);
 
@@ -119,11 +177,34 @@ int main(int argc, const char** argv)
 
                                   // We save the settings for this uuid in the global settings map
                                   settings[client_metadata] = uuid_settings;
+                                  previous_layers.erase(client_metadata); // A new slice starts from scratch.
                               }
                           },
              boost::asio::detached);
 
 
+    // Accounting of the simplify calls, reported when shutting down
+    size_t requests_in_flight = 0;
+    size_t requests_completed = 0;
+    size_t requests_failed = 0; // Completed with an error status.
+    size_t requests_abandoned = 0;
+    const auto account_finished = [&](const bool finished, const grpc::Status& status)
+    {
+        --requests_in_flight;
+        if (! finished)
+        {
+            ++requests_abandoned; // Cancelled because draining took too long.
+        }
+        else if (status.ok())
+        {
+            ++requests_completed;
+        }
+        else
+        {
+            ++requests_failed;
+        }
+    };
+
     // Start the plugin modify process
     boost::asio::co_spawn(
         grpc_context,
@@ -134,15 +215,27 @@ int main(int argc, const char** argv)
                 grpc::ServerContext server_context;
                 cura::plugins::slots::simplify::v0::CallRequest request;
                 grpc::ServerAsyncResponseWriter<cura::plugins::slots::simplify::v0::CallResponse> writer{ &server_context };
-                co_await agrpc::request(&cura::plugins::slots::simplify::v0::SimplifyModifyService::AsyncService::RequestCall, service, server_context, request, writer, boost::asio::use_awaitable);
+                if (! co_await agrpc::request(&cura::plugins::slots::simplify::v0::SimplifyModifyService::AsyncService::RequestCall, service, server_context, request, writer, boost::asio::use_awaitable))
+                {
+                    co_return; // The server is shutting down.
+                }
+                ++requests_in_flight;
+                plugin::trace::span call_span{ "call" };
                 cura::plugins::slots::simplify::v0::CallResponse response;
 
                 auto c_uuid = server_context.client_metadata().find("cura-engine-uuid");
                 if (c_uuid == server_context.client_metadata().end()) {
                     spdlog::warn("cura-engine-uuid not found in client metadata");
+                    const grpc::Status missing_uuid{ grpc::StatusCode::INVALID_ARGUMENT, "cura-engine-uuid not found in client metadata" };
+                    account_finished(co_await agrpc::finish(writer, response, missing_uuid, boost::asio::use_awaitable), missing_uuid);
                     continue;
                 }
                 std::string client_metadata = std::string { c_uuid->second.data(), c_uuid->second.size() };
+                call_span.uuid(client_metadata);
+                if (recording && ! google::protobuf::util::SerializeDelimitedToOstream(request, &recording.value()))
+                {
+                    spdlog::warn("Could not record the simplify request");
+                }
                 auto meshfix_maximum_resolution = static_cast<int>(std::stof(settings[client_metadata].at("meshfix_maximum_resolution")) * 1000);
                 spdlog::info("meshfix_maximum_resolution: {}", meshfix_maximum_resolution);
 
@@ -150,38 +243,79 @@ int main(int argc, const char** argv)
                 try
                 {
                     Simplify simpl(request.max_deviation(), meshfix_maximum_resolution, request.max_area_deviation());
-                    auto* rsp_polygons = response.mutable_polygons()->add_polygons();
 
-                    for (const auto& polygon : request.polygons().polygons())
+                    // Gather the outlines and holes of the whole layer, so that they can share a single vertex budget.
+                    std::vector<geometry::polygon_outer<>> layer;
+                    size_t layer_vertices = 0;
                     {
-                        const auto& outline = polygon.outline();
-                        geometry::polygon_outer outline_poly{};
-                        for (const auto& point : outline.path())
+                        plugin::trace::span convert_span{ "convert" };
+                        convert_span.uuid(client_metadata);
+                        for (const auto& polygon : request.polygons().polygons())
                         {
-                            outline_poly.emplace_back(point.x(), point.y());
+                            auto& outline_poly = layer.emplace_back();
+                            for (const auto& point : polygon.outline().path())
+                            {
+                                outline_poly.emplace_back(point.x(), point.y());
+                            }
+                            layer_vertices += outline_poly.size();
+                            for (const auto& hole : polygon.holes())
+                            {
+                                auto& holes_poly = layer.emplace_back();
+                                for (const auto& point : hole.path())
+                                {
+                                    holes_poly.emplace_back(point.x(), point.y());
+                                }
+                                layer_vertices += holes_poly.size();
+                            }
                         }
-                        concepts::poly_range auto result_outline = simpl.simplify(outline_poly);
+                        convert_span.vertices(layer_vertices);
+                        call_span.vertices(layer_vertices);
+                    }
 
+                    std::vector<geometry::polygon_outer<>> result;
+                    {
+                        plugin::trace::span simplify_span{ "simplify" };
+                        simplify_span.uuid(client_metadata);
+                        simplify_span.vertices(layer_vertices);
+                        if (incremental)
+                        {
+                            auto& client_layer = previous_layers[client_metadata];
+                            client_layer.last_used = ++previous_layers_clock;
+                            if (previous_layers.size() > max_previous_layers)
+                            {
+                                previous_layers.erase(std::ranges::min_element(previous_layers, {}, [](const auto& entry) { return entry.second.last_used; }));
+                            }
+                            client_layer.chains.resize(layer.size());
+                            result.reserve(layer.size());
+                            for (size_t poly_idx = 0; poly_idx < layer.size(); ++poly_idx)
+                            {
+                                result.emplace_back(simplifyIncremental(simpl, layer[poly_idx], client_layer.chains[poly_idx]));
+                            }
+                        }
+                        else
+                        {
+                            result = simpl.simplifyToBudget(layer, vertex_budget, deviation_ceiling);
+                        }
+                    }
+
+                    plugin::trace::span serialize_span{ "serialize" };
+                    serialize_span.uuid(client_metadata);
+                    auto result_poly = result.begin();
+                    for (const auto& polygon : request.polygons().polygons())
+                    {
+                        auto* rsp_polygons = response.mutable_polygons()->add_polygons();
                         auto* rsp_outline = rsp_polygons->mutable_outline();
-                        for (const auto& point : result_outline)
+                        for (const auto& point : *result_poly++)
                         {
                             auto* rsp_outline_path = rsp_outline->add_path();
                             rsp_outline_path->set_x(point.X);
                             rsp_outline_path->set_y(point.Y);
                         }
 
-                        auto* rsp_holes = rsp_polygons->mutable_holes();
-                        for (const auto& hole : polygon.holes())
+                        for (int hole_idx = 0; hole_idx < polygon.holes_size(); ++hole_idx)
                         {
-                            geometry::polygon_outer holes_poly{};
-                            for (const auto& point : hole.path())
-                            {
-                                holes_poly.emplace_back(point.x(), point.y());
-                            }
-                            concepts::poly_range auto holes_result = simpl.simplify(holes_poly);
-
                             auto* rsp_hole = rsp_polygons->mutable_holes()->Add();
-                            for (const auto& point : holes_result)
+                            for (const auto& point : *result_poly++)
                             {
                                 auto* hole_path = rsp_hole->add_path();
                                 hole_path->set_x(point.X);
@@ -200,11 +334,87 @@ int main(int argc, const char** argv)
                 }
 
                 // spdlog::debug("Response: {}", request.DebugString());
-                co_await agrpc::finish(writer, response, status, boost::asio::use_awaitable);
+                plugin::trace::span finish_span{ "finish" };
+                finish_span.uuid(client_metadata);
+                account_finished(co_await agrpc::finish(writer, response, status, boost::asio::use_awaitable), status);
             }
         },
         boost::asio::detached);
+
+#if defined(PLUGIN_TRACING) && defined(SIGUSR1)
+    // Export the trace of the hot path on demand
+    boost::asio::signal_set trace_signals{ grpc_context, SIGUSR1 };
+    boost::asio::co_spawn(
+        grpc_context,
+        [&]() -> boost::asio::awaitable<void>
+        {
+            while (true)
+            {
+                boost::system::error_code error;
+                co_await trace_signals.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, error));
+                if (error)
+                {
+                    co_return; // Cancelled when shutting down.
+                }
+                std::ofstream trace_file{ trace_path };
+                plugin::trace::writeChromeTrace(trace_file, metadata.plugin_name);
+                spdlog::info("Wrote trace to {}", trace_path);
+            }
+        },
+        boost::asio::detached);
+#endif
+
+    // Stop accepting new calls on SIGINT or SIGTERM, and give the calls in flight some time to finish
+    std::thread shutdown_thread;
+    boost::asio::signal_set shutdown_signals{ grpc_context, SIGINT, SIGTERM };
+    shutdown_signals.async_wait(
+        [&](const boost::system::error_code& error, const int signal_number)
+        {
+            if (error)
+            {
+                return;
+            }
+            spdlog::info("Received signal {}, draining {} requests in flight for at most {} s", signal_number, requests_in_flight, drain_timeout.count());
+#if defined(PLUGIN_TRACING) && defined(SIGUSR1)
+            trace_signals.cancel();
+#endif
+            // Shutdown blocks until all calls are done, which needs the grpc_context to keep running; so shut down from another thread.
+            // Calls that are still in flight after the deadline are cancelled. The handlers then see their requests fail and return,
+            // after which grpc_context.run() runs out of work.
+            shutdown_thread = std::thread([&server, deadline = std::chrono::system_clock::now() + drain_timeout] { server->Shutdown(deadline); });
+        });
+    startup.phase("spawn_handlers");
+
+    // Tell whoever launched us that the server accepts calls, so they don't have to poll the handshake.
+    if (args.at("--ready-stdout").asBool())
+    {
+        fmt::print("READY {}\n", address);
+        std::fflush(stdout);
+    }
+    if (const auto& ready_fd = args.at("--ready-fd"))
+    {
+        plugin::startup::notifyFd(static_cast<int>(ready_fd.asLong()), address);
+    }
+    plugin::startup::notifyServiceManager();
+    spdlog::info("Ready to accept calls on {}, {:.3f} ms after starting", address, startup.elapsed());
+
     grpc_context.run();
 
-    server->Shutdown();
-}
\ No newline at end of file
+    if (shutdown_thread.joinable())
+    {
+        shutdown_thread.join();
+    }
+    else
+    {
+        server->Shutdown();
+    }
+
+    requests_abandoned += requests_in_flight;
+    spdlog::info("Shut down after completing {} requests, {} requests failed, {} requests were abandoned", requests_completed, requests_failed, requests_abandoned);
+#ifdef PLUGIN_TRACING
+    std::ofstream trace_file{ trace_path };
+    plugin::trace::writeChromeTrace(trace_file, metadata.plugin_name);
+    spdlog::info("Wrote trace to {}", trace_path);
+#endif
+    spdlog::shutdown(); // Flushes the logs.
+}